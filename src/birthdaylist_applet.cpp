@@ -19,11 +19,22 @@
 #include "birthdaylist_applet.h"
 #include "birthdaylist_aboutdata.h"
 #include "birthdaylist_confighelper.h"
+#include "birthdaylist_configui.h"
+#include "birthdaylist_diagnostics.h"
 #include "birthdaylist_model.h"
+#include "birthdaylist_modelentry.h"
+#include "birthdaylist_trace.h"
 #include "birthdaylist_view.h"
 #include <KAboutApplicationDialog>
 #include <KConfigDialog>
+#include <KIdleTime>
+#include <Plasma/Containment>
+#include <Plasma/Theme>
+#include <Plasma/ToolTipContent>
+#include <Plasma/ToolTipManager>
 #include <QGraphicsLinearLayout>
+#include <QPainter>
+#include <QTextDocument>
 #include <QTreeView>
 
 
@@ -35,30 +46,73 @@ BirthdayList::Applet::Applet(QObject *parent, const QVariantList &args)
 : Plasma::PopupApplet(parent, args),
 m_aboutData(new BirthdayList::AboutData()),
 m_configHelper(new BirthdayList::ConfigHelper()),
+m_configUi(0),
 m_model(new BirthdayList::Model()),
 m_view(new BirthdayList::View(m_model, 0)),
-m_graphicsWidget(0)
+m_graphicsWidget(0),
+m_viewSettingsChanged(false),
+m_badgeCount(-1),
+m_startIdleTimeout(-1)
 {
     kDebug() << "Creating BirthdayList plasmoid";
+    Diagnostics::instance()->recordMilestone("appletConstructed");
     setBackgroundHints(DefaultBackground);
     setAspectRatioMode(Plasma::IgnoreAspectRatio);
     setHasConfigurationInterface(true);
+
+    m_storeViewSettingsTimer.setSingleShot(true);
+    m_storeViewSettingsTimer.setInterval(m_storeViewSettingsDelay);
+    connect(&m_storeViewSettingsTimer, SIGNAL(timeout()), this, SLOT(storeViewSettings()));
+
+    m_startSourcesTimer.setSingleShot(true);
+    connect(&m_startSourcesTimer, SIGNAL(timeout()), this, SLOT(startSources()));
    
     //resize(350, 200);
 }
 
 BirthdayList::Applet::~Applet() 
 {
+    if (m_startIdleTimeout >= 0) KIdleTime::instance()->removeIdleTimeout(m_startIdleTimeout);
+
+    // the changes are written to the config group only, Plasma saves it when the applet is destroyed
+    if (m_viewSettingsChanged) {
+        KConfigGroup configGroup = config();
+        m_configHelper->storeConfiguration(configGroup, m_model->getConfiguration(), m_view->getConfiguration());
+    }
+
     delete m_graphicsWidget;
     // m_view should be deleted automatically
     delete m_model;
+    delete m_configUi;
     delete m_configHelper;
     delete m_aboutData;
 }
 
 void BirthdayList::Applet::init() 
 {
+    // diagnostics: BIRTHDAYLIST_TRACE=<file> writes a Chrome trace of the categories listed in BIRTHDAYLIST_TRACE_CATEGORIES
+    // (applet, model, sources, view or all, which is the default); has effect only if built with BIRTHDAYLIST_TRACING
+    QString traceFile = QString::fromLocal8Bit(qgetenv("BIRTHDAYLIST_TRACE"));
+    if (!traceFile.isEmpty()) {
+        QString traceCategories = QString::fromLocal8Bit(qgetenv("BIRTHDAYLIST_TRACE_CATEGORIES"));
+        Trace::start(traceFile, Trace::parseCategories(traceCategories.isEmpty() ? "all" : traceCategories));
+    }
+    BL_TRACE_SPAN(TC_Applet, "init");
+
+    // diagnostics: BIRTHDAYLIST_STALL_BUDGET=<ms> replaces the budget of the slot stall warnings (16 ms)
+    int stallBudget = qgetenv("BIRTHDAYLIST_STALL_BUDGET").toInt();
+    if (stallBudget > 0) SlotWatchdog::setBudget(stallBudget);
+
+    Diagnostics::instance()->recordMilestone("appletInit");
+
     setPopupIcon(KIcon("bl_cookie", NULL));
+    // the summary is computed from the event list, so it doesn't need the popup to be opened
+    connect(m_model, SIGNAL(eventsUpdated()), this, SLOT(updatePanelSummary()));
+    Plasma::ToolTipManager::self()->registerWidget(this);
+    // the containment of another activity is taken off the screen
+    if (containment()) {
+        connect(containment(), SIGNAL(screenChanged(int,int,Plasma::Containment*)), this, SLOT(containmentScreenChanged()));
+    }
 
     // configure the model and view from the persisted plasmoid configuration
     ModelConfiguration modelConf;
@@ -66,10 +120,20 @@ void BirthdayList::Applet::init()
     
     KConfigGroup configGroup = config();
     m_configHelper->loadConfiguration(configGroup, modelConf, viewConf);
+
+    // the Akonadi session and monitors are created only when the popup is opened or the session is idle,
+    // so that they don't compete with the rest of the desktop during its startup (the midnight update still runs)
+    if (m_configHelper->startIdleSeconds() > 0) {
+        m_model->holdSources();
+        m_startIdleTimeout = KIdleTime::instance()->addIdleTimeout(m_configHelper->startIdleSeconds() * 1000);
+        connect(KIdleTime::instance(), SIGNAL(timeoutReached(int)), this, SLOT(idleTimeoutReached(int)));
+        scheduleSourcesStart();
+    }
     m_model->setConfiguration(modelConf);
     m_view->setConfiguration(viewConf);
     
     connect(m_view, SIGNAL(settingsChanged()), this, SLOT(viewSettingChanged()));
+    connect(m_view, SIGNAL(settingsChangeFinished()), this, SLOT(storeViewSettings()));
 }
 
 QGraphicsWidget *BirthdayList::Applet::graphicsWidget() 
@@ -110,12 +174,135 @@ QList<QAction *> BirthdayList::Applet::contextualActions()
     return currentActions;
 }
 
+void BirthdayList::Applet::popupEvent(bool show)
+{
+    if (show) startSources();
+    updateSuspension(show);
+    Plasma::PopupApplet::popupEvent(show);
+}
+
+void BirthdayList::Applet::constraintsEvent(Plasma::Constraints constraints)
+{
+    if (constraints & Plasma::FormFactorConstraint) {
+        updateSuspension(isPopupShowing());
+        scheduleSourcesStart();
+    }
+    Plasma::PopupApplet::constraintsEvent(constraints);
+}
+
+void BirthdayList::Applet::updateSuspension(bool popupShown)
+{
+    // on the desktop the list is shown directly in the applet, unless the desktop belongs to another activity
+    bool collapsed = formFactor() == Plasma::Horizontal || formFactor() == Plasma::Vertical;
+    bool offScreen = containment() && containment()->screen() < 0;
+    m_model->setSuspended((collapsed && !popupShown) || offScreen);
+}
+
+void BirthdayList::Applet::containmentScreenChanged()
+{
+    updateSuspension(isPopupShowing());
+}
+
+void BirthdayList::Applet::scheduleSourcesStart()
+{
+    // the sources are not held anymore
+    if (m_startIdleTimeout < 0) return;
+
+    bool collapsed = formFactor() == Plasma::Horizontal || formFactor() == Plasma::Vertical;
+    m_startSourcesTimer.start(collapsed ? m_startSourcesTimeout : m_startSourcesDesktopDelay);
+}
+
+void BirthdayList::Applet::startSources()
+{
+    m_startSourcesTimer.stop();
+    if (m_startIdleTimeout >= 0) {
+        disconnect(KIdleTime::instance(), SIGNAL(timeoutReached(int)), this, SLOT(idleTimeoutReached(int)));
+        KIdleTime::instance()->removeIdleTimeout(m_startIdleTimeout);
+        m_startIdleTimeout = -1;
+    }
+    m_model->startSources();
+}
+
+void BirthdayList::Applet::idleTimeoutReached(int identifier)
+{
+    if (identifier != m_startIdleTimeout) return;
+    SlotWatchdog watchdog("Applet::idleTimeoutReached");
+    kDebug() << "Session idle, starting the contact sources";
+    startSources();
+}
+
+void BirthdayList::Applet::updatePanelSummary()
+{
+    BL_TRACE_SPAN(TC_Applet, "updatePanelSummary");
+    int todayCount = m_model->todayEventCount();
+    if (todayCount != m_badgeCount) {
+        m_badgeCount = todayCount;
+        if (todayCount > 0) setPopupIcon(badgeIcon(todayCount));
+        else setPopupIcon(KIcon("bl_cookie", NULL));
+    }
+
+    QStringList upcomingLines;
+    foreach (const AbstractAnnualEventEntry *entry, m_model->upcomingEntries(m_tooltipEntries)) {
+        upcomingLines << QString("%1: %2").arg(AbstractAnnualEventEntry::remainingDaysString(entry->remainingDays()))
+                                         .arg(Qt::escape(entry->name()));
+    }
+
+    QString mainText = todayCount > 0 ? i18ncp("Tooltip title", "%1 event today", "%1 events today", todayCount)
+                                      : i18nc("Tooltip title", "No events today");
+    QString subText = upcomingLines.isEmpty() ? i18nc("Tooltip text", "No upcoming events") : upcomingLines.join("<br/>");
+    Plasma::ToolTipContent toolTip(mainText, subText, KIcon("bl_cookie", NULL));
+    Plasma::ToolTipManager::self()->setContent(this, toolTip);
+}
+
+QIcon BirthdayList::Applet::badgeIcon(int count) const
+{
+    // the badge uses the colors of today's events
+    ModelConfiguration modelConf = m_model->getConfiguration();
+    QColor badgeColor = modelConf.todayColorSettings.brushBackground.color();
+    QColor textColor = modelConf.todayColorSettings.brushForeground.color();
+    QString text = count < 100 ? QString::number(count) : QString("99+");
+
+    KIcon baseIcon("bl_cookie", NULL);
+    QIcon icon;
+    const int sizes[] = { 16, 22, 32, 48, 64 };
+    for (unsigned int i=0; i<sizeof(sizes)/sizeof(sizes[0]); ++i) {
+        QPixmap pixmap = baseIcon.pixmap(sizes[i]);
+        if (pixmap.isNull()) continue;
+
+        QPainter painter(&pixmap);
+        painter.setRenderHint(QPainter::Antialiasing);
+        QFont font = Plasma::Theme::defaultTheme()->font(Plasma::Theme::SmallestFont);
+        font.setBold(true);
+        font.setPixelSize(qMax(7, pixmap.height() * 2 / 5));
+        painter.setFont(font);
+
+        QFontMetrics fontMetrics(font);
+        int badgeHeight = fontMetrics.height();
+        int badgeWidth = qMax(badgeHeight, fontMetrics.width(text) + badgeHeight / 2);
+        QRect badgeRect(pixmap.width() - badgeWidth, pixmap.height() - badgeHeight, badgeWidth, badgeHeight);
+
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(badgeColor);
+        painter.drawRoundedRect(badgeRect, badgeHeight / 2.0, badgeHeight / 2.0);
+        painter.setPen(textColor);
+        painter.drawText(badgeRect, Qt::AlignCenter, text);
+        painter.end();
+
+        icon.addPixmap(pixmap);
+    }
+    return icon;
+}
+
 void BirthdayList::Applet::createConfigurationInterface(KConfigDialog *parent) 
 {
+    // the dialog lists the Akonadi collections
+    startSources();
+
     ModelConfiguration modelConf = m_model->getConfiguration();
     ViewConfiguration viewConf = m_view->getConfiguration();
     
-    m_configHelper->createConfigurationUI(parent, m_model, modelConf, viewConf);
+    if (!m_configUi) m_configUi = new BirthdayList::ConfigUi();
+    m_configUi->createConfigurationUI(parent, m_model, m_configHelper->showDiagnostics(), modelConf, viewConf);
 
     connect(parent, SIGNAL(okClicked()), this, SLOT(configAccepted()));
     parent->resize(parent->minimumSizeHint());
@@ -123,27 +310,41 @@ void BirthdayList::Applet::createConfigurationInterface(KConfigDialog *parent)
 
 void BirthdayList::Applet::configAccepted() 
 {
+    SlotWatchdog watchdog("Applet::configAccepted");
     ModelConfiguration modelConf;
     // get the view configuration from the view since it contains some items that are updated directly by the view (such as column widths)
     ViewConfiguration viewConf = m_view->getConfiguration();
 
-    m_configHelper->updateConfigurationFromUI(modelConf, viewConf);
+    m_configUi->updateConfigurationFromUI(modelConf, viewConf);
     
+    // the badge is redrawn with the new colors
+    m_badgeCount = -1;
     m_model->setConfiguration(modelConf);
     m_view->setConfiguration(viewConf);
 
+    // the pending view settings are stored together with the rest
+    m_storeViewSettingsTimer.stop();
+    m_viewSettingsChanged = false;
     KConfigGroup configGroup = config();
-    m_configHelper->storeConfiguration(configGroup, modelConf, viewConf);
-
-    emit configNeedsSaving();
+    if (m_configHelper->storeConfiguration(configGroup, modelConf, viewConf)) emit configNeedsSaving();
 }
 
 void BirthdayList::Applet::viewSettingChanged()
 {
-    KConfigGroup configGroup = config();
-    m_configHelper->storeConfiguration(configGroup, m_model->getConfiguration(), m_view->getConfiguration());
+    m_viewSettingsChanged = true;
+    m_storeViewSettingsTimer.start();
+}
 
-    emit configNeedsSaving();
+void BirthdayList::Applet::storeViewSettings()
+{
+    if (!m_viewSettingsChanged) return;
+    m_viewSettingsChanged = false;
+    m_storeViewSettingsTimer.stop();
+
+    KConfigGroup configGroup = config();
+    if (m_configHelper->storeConfiguration(configGroup, m_model->getConfiguration(), m_view->getConfiguration())) {
+        emit configNeedsSaving();
+    }
 }
 
 void BirthdayList::Applet::about() 
@@ -20,9 +20,12 @@
 
 
 #include <Plasma/PopupApplet>
+#include <QIcon>
+#include <QTimer>
 
 namespace BirthdayList {
     class ConfigHelper;
+    class ConfigUi;
     class Model;
     class View;
     class ViewConfiguration;
@@ -45,23 +48,51 @@ namespace BirthdayList
         /** Creates the widget that will be shown in the Plasma applet. */
         QGraphicsWidget *graphicsWidget();
         virtual QList<QAction *> contextualActions();
+
+    protected:
+        /** Starts the contact sources when the popup is opened for the first time, suspends the model while it is closed */
+        virtual void popupEvent(bool show);
+        /** Suspends the model if the applet is collapsed to a panel icon */
+        virtual void constraintsEvent(Plasma::Constraints constraints);
         
     private slots:
         /** Receives a notification when the user accepts the configuration change. */
         void configAccepted();
+        /** Schedules storing of the view settings changed by the user (e.g. the column widths while dragging) */
         void viewSettingChanged();
+        /** Stores the scheduled settings now */
+        void storeViewSettings();
+        /** Updates the today's event count in the popup icon and the upcoming events in the tooltip */
+        void updatePanelSummary();
+        /** Starts the contact sources once the session has been idle long enough */
+        void idleTimeoutReached(int identifier);
+        /** Starts the contact sources held since init */
+        void startSources();
+        /** Suspends the model while the containment is not shown (it belongs to another activity) */
+        void containmentScreenChanged();
         void about();
 
     private:
         /** Creates the configuration dialog and fills it with current settings. */
         void createConfigurationInterface(KConfigDialog *parent);
+        /** Schedules the start of the held contact sources: shortly on the desktop, where the list is visible,
+         *  otherwise at the latest after m_startSourcesTimeout even if the session is never idle */
+        void scheduleSourcesStart();
+        /** Suspends the model if the list is not visible (collapsed in a panel and the popup is closed,
+         *  or the containment is on another activity) */
+        void updateSuspension(bool popupShown);
+        /** Returns the applet icon with the given count drawn in a badge over it */
+        QIcon badgeIcon(int count) const;
 
         /** BirthdayList specific contents of the about dialog */
         KAboutData *m_aboutData;
 
-        /** Helper object to read/write the model and view configuration from/to the persistent storage and configuration UI */
+        /** Helper object to read/write the model and view configuration from/to the persistent storage */
         ConfigHelper *m_configHelper;
 
+        /** Configuration dialog contents (created when the dialog is opened for the first time) */
+        ConfigUi *m_configUi;
+
         /** Internal data model (table contents) */
         Model *m_model;
         
@@ -70,6 +101,23 @@ namespace BirthdayList
 
         /** Widget containing the BirthdayList view and shown in the Plasma applet */
         QGraphicsWidget *m_graphicsWidget;
+
+        /** Coalesces the view setting changes, so that a column drag doesn't save the configuration for every pixel */
+        QTimer m_storeViewSettingsTimer;
+        bool m_viewSettingsChanged;
+        static const int m_storeViewSettingsDelay = 2000;
+
+        /** Count shown in the badge of the popup icon (0 if no badge is shown), -1 before the first update */
+        int m_badgeCount;
+        /** Number of upcoming events listed in the tooltip */
+        static const int m_tooltipEntries = 5;
+
+        /** Identifier of the idle timeout starting the held contact sources, or -1 */
+        int m_startIdleTimeout;
+        /** Starts the held contact sources if neither the popup was opened nor the session was idle */
+        QTimer m_startSourcesTimer;
+        static const int m_startSourcesDesktopDelay = 2000;
+        static const int m_startSourcesTimeout = 120000;
     };
 };
 
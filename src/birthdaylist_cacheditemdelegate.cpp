@@ -0,0 +1,126 @@
+/**
+ * @file    birthdaylist_cacheditemdelegate.cpp
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_cacheditemdelegate.h"
+#include <QHeaderView>
+#include <QPainter>
+#include <QTreeView>
+
+
+BirthdayList::CachedItemDelegate::RowKey::RowKey(const QModelIndex &index, uint generation, int state)
+: parent(index.internalPointer()),
+row(index.row()),
+generation(generation),
+state(state)
+{
+}
+
+bool BirthdayList::CachedItemDelegate::RowKey::operator==(const RowKey &other) const
+{
+    return parent == other.parent && row == other.row && generation == other.generation && state == other.state;
+}
+
+namespace BirthdayList
+{
+    uint qHash(const CachedItemDelegate::RowKey &key)
+    {
+        return ::qHash(key.parent) ^ uint(key.row) ^ (key.generation << 20) ^ (uint(key.state) << 8);
+    }
+}
+
+
+BirthdayList::CachedItemDelegate::CachedItemDelegate(QObject *parent)
+: QStyledItemDelegate(parent),
+m_rowCache(m_maxCachedPixels),
+m_generation(0)
+{
+}
+
+BirthdayList::CachedItemDelegate::~CachedItemDelegate()
+{
+}
+
+void BirthdayList::CachedItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    QStyleOptionViewItemV4 rowOption(option);
+    const QTreeView *treeView = qobject_cast<const QTreeView*>(rowOption.widget);
+    const QHeaderView *header = treeView ? treeView->header() : 0;
+    int pixels = header ? header->length() * option.rect.height() : 0;
+    if (pixels <= 0 || pixels > m_maxCachedPixels || option.direction == Qt::RightToLeft) {
+        QStyledItemDelegate::paint(painter, option, index);
+        return;
+    }
+
+    const QStyle::State paintedState = QStyle::State_Enabled | QStyle::State_Active | QStyle::State_Selected |
+        QStyle::State_MouseOver | QStyle::State_HasFocus;
+    int state = int(option.state & paintedState) | ((rowOption.features & QStyleOptionViewItemV2::Alternate) ? m_alternateRowState : 0);
+    RowKey key(index, m_generation, state);
+
+    QPixmap *rowPixmap = m_rowCache.object(key);
+    if (rowPixmap == 0 || rowPixmap->width() != header->length() || rowPixmap->height() != option.rect.height()) {
+        rowPixmap = paintRow(treeView, rowOption, index);
+        m_rowCache.insert(key, rowPixmap, pixels);
+    }
+
+    // the cell is the slice of the row under its rectangle (the header positions are not scrolled)
+    QRect cellSlice(option.rect.x() + header->offset(), 0, option.rect.width(), option.rect.height());
+    painter->drawPixmap(option.rect.topLeft(), *rowPixmap, cellSlice);
+}
+
+QPixmap *BirthdayList::CachedItemDelegate::paintRow(const QTreeView *treeView, const QStyleOptionViewItemV4 &option, const QModelIndex &index) const
+{
+    const QHeaderView *header = treeView->header();
+    QPixmap *rowPixmap = new QPixmap(header->length(), option.rect.height());
+
+    // the view paints the row background itself; on an opaque background the pixmap gets the same one, so that
+    // the text keeps its subpixel antialiasing (a translucent background gets greyscale antialiasing anyway)
+    QColor background = option.palette.color((option.features & QStyleOptionViewItemV2::Alternate) ? QPalette::AlternateBase : QPalette::Base);
+    rowPixmap->fill(background.alpha() == 255 ? background : QColor(Qt::transparent));
+
+    // the first column is indented as in QTreeView::drawRow
+    int depth = 0;
+    for (QModelIndex ancestor = index.parent(); ancestor.isValid(); ancestor = ancestor.parent()) ++depth;
+    int indentation = treeView->indentation() * (depth + (treeView->rootIsDecorated() ? 1 : 0));
+
+    QPainter rowPainter(rowPixmap);
+    for (int column=0; column<header->count(); ++column) {
+        if (header->isSectionHidden(column)) continue;
+
+        QStyleOptionViewItemV4 cellOption(option);
+        cellOption.rect = QRect(header->sectionPosition(column), 0, header->sectionSize(column), option.rect.height());
+        if (column == 0) cellOption.rect.adjust(indentation, 0, 0, 0);
+        QStyledItemDelegate::paint(&rowPainter, cellOption, index.sibling(index.row(), column));
+    }
+    rowPainter.end();
+
+    return rowPixmap;
+}
+
+void BirthdayList::CachedItemDelegate::invalidate()
+{
+    // the outdated rows are not looked up anymore and get dropped as the least recently used ones
+    ++m_generation;
+}
+
+void BirthdayList::CachedItemDelegate::rowsInserted(const QModelIndex &parent, int start, int end)
+{
+    Q_UNUSED(start);
+
+    const QAbstractItemModel *model = qobject_cast<const QAbstractItemModel*>(sender());
+    if (model == 0 || end + 1 < model->rowCount(parent)) invalidate();
+}
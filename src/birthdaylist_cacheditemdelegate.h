@@ -0,0 +1,83 @@
+#ifndef BIRTHDAYLIST_CACHEDITEMDELEGATE_H
+#define BIRTHDAYLIST_CACHEDITEMDELEGATE_H
+
+/**
+ * @file    birthdaylist_cacheditemdelegate.h
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include <QCache>
+#include <QPixmap>
+#include <QStyledItemDelegate>
+
+class QTreeView;
+
+
+namespace BirthdayList 
+{
+    /**
+    * Item delegate that paints every row of the tree view once into a pixmap (all its visible cells at the positions
+    * given by the header) and then paints each cell as a slice of that pixmap, so that showing the popup again or
+    * scrolling back only copies the pixmaps. The rows are looked up by their position in the model and the generation
+    * of the cache, which the view bumps whenever the rows, their contents, the columns or the theme change, so a paint
+    * doesn't read any data of the model when the row is cached; the least recently used pixmaps are dropped when the
+    * cache is full.
+    */
+    class CachedItemDelegate : public QStyledItemDelegate
+    {
+        Q_OBJECT
+    public:
+        explicit CachedItemDelegate(QObject *parent = 0);
+        virtual ~CachedItemDelegate();
+
+        virtual void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const;
+
+    public slots:
+        /** Makes all cached rows outdated (e.g. when the model data, the columns or the Plasma theme change) */
+        void invalidate();
+        /** Makes the cached rows outdated unless the rows were appended after them (a next page of the rows or
+         *  the children of an expanded entry), connected to the rowsInserted signal of the model */
+        void rowsInserted(const QModelIndex &parent, int start, int end);
+
+    private:
+        /** Identification of a cached row: its position in the model, the cache generation and the painted state */
+        struct RowKey
+        {
+            RowKey(const QModelIndex &index, uint generation, int state);
+            bool operator==(const RowKey &other) const;
+
+            const void *parent;
+            int row;
+            uint generation;
+            /** Painted state of the row and whether it has the alternate background */
+            int state;
+        };
+        friend uint qHash(const RowKey &key);
+
+        /** Paints all visible cells of the row into a pixmap as wide as all columns of the header */
+        QPixmap *paintRow(const QTreeView *treeView, const QStyleOptionViewItemV4 &option, const QModelIndex &index) const;
+
+        mutable QCache<RowKey, QPixmap> m_rowCache;
+        uint m_generation;
+        /** Bit of RowKey::state marking the alternate background (above the bits of QStyle::State) */
+        static const int m_alternateRowState = 1 << 30;
+        /** Maximum number of cached pixels (about 4 MB) */
+        static const int m_maxCachedPixels = 1024 * 1024;
+    };
+};
+
+
+#endif //BIRTHDAYLIST_CACHEDITEMDELEGATE_H
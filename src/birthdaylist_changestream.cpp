@@ -0,0 +1,200 @@
+/**
+ * @file    birthdaylist_changestream.cpp
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_changestream.h"
+#include <KDebug>
+#include <QStringList>
+#include <QTextStream>
+
+
+BirthdayList::ContactFingerprint::ContactFingerprint()
+: isValid(false),
+uidHash(0),
+contentHash(0),
+nameLength(0),
+categoryCount(0),
+customFieldCount(0),
+hasNickName(false),
+hasBirthday(false),
+hasAnniversary(false)
+{
+}
+
+BirthdayList::ContactFingerprint BirthdayList::ContactFingerprint::fromContact(const AddresseeInfo &contactInfo, const QString &uid)
+{
+    // the custom fields are sorted, so that equal contacts always give the same content hash
+    QStringList customFields;
+    QHashIterator<QString, QVariant> fieldIt(contactInfo.customFields);
+    while (fieldIt.hasNext()) {
+        fieldIt.next();
+        customFields.append(fieldIt.key() + '=' + fieldIt.value().toString());
+    }
+    customFields.sort();
+
+    QStringList content;
+    content << contactInfo.name << contactInfo.nickName << contactInfo.givenName << contactInfo.email << contactInfo.homepage
+            << contactInfo.birthday.toString(Qt::ISODate) << contactInfo.categories.join(",") << customFields.join(",");
+
+    ContactFingerprint fingerprint;
+    fingerprint.isValid = true;
+    fingerprint.uidHash = qHash(uid);
+    fingerprint.contentHash = qHash(content.join("|"));
+    fingerprint.nameLength = contactInfo.name.length();
+    fingerprint.categoryCount = contactInfo.categories.size();
+    fingerprint.customFieldCount = contactInfo.customFields.size();
+    fingerprint.hasNickName = !contactInfo.nickName.isEmpty();
+    fingerprint.hasBirthday = contactInfo.birthday.isValid();
+    fingerprint.hasAnniversary = contactInfo.customFields.contains("Custom_KADDRESSBOOK-X-Anniversary");
+    return fingerprint;
+}
+
+BirthdayList::ContactFingerprint BirthdayList::ContactFingerprint::fromString(const QString &string)
+{
+    ContactFingerprint fingerprint;
+    QStringList fields = string.split(':');
+    if (fields.size() != 6) return fingerprint;
+
+    bool uidValid, contentValid;
+    fingerprint.uidHash = fields[0].toUInt(&uidValid, 16);
+    fingerprint.contentHash = fields[1].toUInt(&contentValid, 16);
+    fingerprint.nameLength = fields[2].toInt();
+    fingerprint.categoryCount = fields[3].toInt();
+    fingerprint.customFieldCount = fields[4].toInt();
+    fingerprint.hasNickName = fields[5].contains('n');
+    fingerprint.hasBirthday = fields[5].contains('b');
+    fingerprint.hasAnniversary = fields[5].contains('a');
+    fingerprint.isValid = uidValid && contentValid;
+    return fingerprint;
+}
+
+QString BirthdayList::ContactFingerprint::toString() const
+{
+    QString flags;
+    if (hasNickName) flags += 'n';
+    if (hasBirthday) flags += 'b';
+    if (hasAnniversary) flags += 'a';
+    if (flags.isEmpty()) flags = "-";
+
+    return QString("%1:%2:%3:%4:%5:%6").arg(uidHash, 0, 16).arg(contentHash, 0, 16)
+            .arg(nameLength).arg(categoryCount).arg(customFieldCount).arg(flags);
+}
+
+BirthdayList::AddresseeInfo BirthdayList::ContactFingerprint::createContact() const
+{
+    // everything that may differ between two versions of the contact is derived from the content hash
+    AddresseeInfo contactInfo;
+    contactInfo.givenName = QString("Given%1").arg(uidHash % 500);
+    contactInfo.name = QString("%1 %2").arg(contactInfo.givenName).arg(contentHash, 8, 16, QChar('0'));
+    contactInfo.name = contactInfo.name.leftJustified(nameLength, 'x', true);
+    if (hasNickName) contactInfo.nickName = QString("Nick%1").arg(uidHash, 0, 16);
+    contactInfo.email = QString("replay%1@example.org").arg(contentHash, 0, 16);
+
+    if (hasBirthday) contactInfo.birthday = QDate(1930, 1, 1).addDays(contentHash % (80 * 365));
+    if (hasAnniversary) {
+        contactInfo.customFields.insert("Custom_KADDRESSBOOK-X-Anniversary", QDate(1960, 1, 1).addDays((contentHash >> 8) % (50 * 365)));
+    }
+    for (int i=0; i<categoryCount; ++i) {
+        contactInfo.categories.append(QString("Category%1").arg(i));
+    }
+    while (contactInfo.customFields.size() < customFieldCount) {
+        int field = contactInfo.customFields.size();
+        contactInfo.customFields.insert(QString("Custom_KADDRESSBOOK-Replay%1").arg(field), QString::number((contentHash >> field) & 1));
+    }
+
+    return contactInfo;
+}
+
+QString BirthdayList::ContactFingerprint::uid() const
+{
+    return QString("replay-%1").arg(uidHash, 0, 16);
+}
+
+
+BirthdayList::ChangeStreamRecorder::ChangeStreamRecorder(const QString &fileName)
+: m_file(fileName)
+{
+    if (m_file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        kDebug() << "Recording the Akonadi change stream to" << fileName;
+    }
+    else {
+        kWarning() << "Cannot record the Akonadi change stream to" << fileName;
+    }
+    m_timer.start();
+}
+
+BirthdayList::ChangeStreamRecorder::~ChangeStreamRecorder()
+{
+}
+
+void BirthdayList::ChangeStreamRecorder::record(ChangeStreamEvent event)
+{
+    if (!m_file.isOpen()) return;
+
+    static const char *typeNames[] = { "inserted", "removed", "changed" };
+    event.msecs = m_timer.elapsed();
+
+    QTextStream stream(&m_file);
+    stream << event.msecs << ' ' << typeNames[event.type] << ' ' << event.parentLevel << ' ' << event.firstRow << ' ' << event.lastRow;
+    foreach (const ContactFingerprint &fingerprint, event.rows) {
+        stream << ' ' << (fingerprint.isValid ? fingerprint.toString() : QString("-"));
+    }
+    stream << '\n';
+    // flush every event, the stalls being recorded may end with the applet being killed
+    stream.flush();
+    m_file.flush();
+}
+
+QList<BirthdayList::ChangeStreamEvent> BirthdayList::ChangeStreamRecorder::load(const QString &fileName)
+{
+    QList<ChangeStreamEvent> events;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        kWarning() << "Cannot read the Akonadi change stream from" << fileName;
+        return events;
+    }
+
+    QTextStream stream(&file);
+    int skippedLines = 0;
+    while (!stream.atEnd()) {
+        QStringList fields = stream.readLine().split(' ', QString::SkipEmptyParts);
+        if (fields.size() < 5) {
+            ++skippedLines;
+            continue;
+        }
+
+        ChangeStreamEvent event;
+        if (fields[1] == "inserted") event.type = ChangeStreamEvent::CE_RowsInserted;
+        else if (fields[1] == "removed") event.type = ChangeStreamEvent::CE_RowsRemoved;
+        else if (fields[1] == "changed") event.type = ChangeStreamEvent::CE_DataChanged;
+        else {
+            ++skippedLines;
+            continue;
+        }
+        event.msecs = fields[0].toLongLong();
+        event.parentLevel = fields[2].toInt();
+        event.firstRow = fields[3].toInt();
+        event.lastRow = fields[4].toInt();
+        for (int i=5; i<fields.size(); ++i) {
+            event.rows.append(ContactFingerprint::fromString(fields[i]));
+        }
+        events.append(event);
+    }
+
+    kDebug() << "Read" << events.size() << "events and skipped" << skippedLines << "lines of the Akonadi change stream" << fileName;
+    return events;
+}
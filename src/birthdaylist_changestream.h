@@ -0,0 +1,106 @@
+#ifndef BIRTHDAYLIST_CHANGESTREAM_H
+#define BIRTHDAYLIST_CHANGESTREAM_H
+
+/**
+ * @file    birthdaylist_changestream.h
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_source_contacts.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QString>
+
+
+namespace BirthdayList 
+{
+    /**
+    * Anonymized description of a contact: it keeps only the hashes of the identity and content
+    * and the shape of the contact (which fields are filled in), so that a similar contact can be recreated for the replay.
+    */
+    struct ContactFingerprint
+    {
+        ContactFingerprint();
+
+        /** Creates the fingerprint of the given contact */
+        static ContactFingerprint fromContact(const AddresseeInfo &contactInfo, const QString &uid);
+        /** Parses the fingerprint written by toString(); returns an invalid fingerprint if it cannot be parsed */
+        static ContactFingerprint fromString(const QString &string);
+        QString toString() const;
+
+        /** Creates a contact with the same shape; contacts with the same content hash are equal */
+        AddresseeInfo createContact() const;
+        QString uid() const;
+
+        bool isValid;
+        uint uidHash;
+        uint contentHash;
+        int nameLength;
+        int categoryCount;
+        int customFieldCount;
+        bool hasNickName;
+        bool hasBirthday;
+        bool hasAnniversary;
+    };
+
+
+    /** One signal of the contacts model (EntityTreeModel) */
+    struct ChangeStreamEvent
+    {
+        enum Type { CE_RowsInserted, CE_RowsRemoved, CE_DataChanged };
+
+        Type type;
+        /** Time since the start of the recording */
+        qint64 msecs;
+        /** Depth of the parent of the rows (0 for the top level rows, 1 for the contacts in a collection) */
+        int parentLevel;
+        int firstRow;
+        int lastRow;
+        /** Fingerprints of the rows (not recorded for the removed rows) */
+        QList<ContactFingerprint> rows;
+    };
+
+
+    /**
+    * Writes the signals of the contacts model to a file, one event per line:
+    * "<msecs> <inserted|removed|changed> <parent level> <first row> <last row> [<fingerprint> ...]".
+    * The file can be replayed offline by AkonadiStandIn::scriptRecording.
+    */
+    class ChangeStreamRecorder
+    {
+    public:
+        explicit ChangeStreamRecorder(const QString &fileName);
+        ~ChangeStreamRecorder();
+
+        bool isOpen() const {
+            return m_file.isOpen();
+        }
+
+        /** Writes the event, its time is taken from the recorder's clock */
+        void record(ChangeStreamEvent event);
+
+        /** Reads all events of the given recording */
+        static QList<ChangeStreamEvent> load(const QString &fileName);
+
+    private:
+        QFile m_file;
+        QElapsedTimer m_timer;
+    };
+};
+
+
+#endif //BIRTHDAYLIST_CHANGESTREAM_H
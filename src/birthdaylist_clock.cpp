@@ -0,0 +1,74 @@
+/**
+ * @file    birthdaylist_clock.cpp
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_clock.h"
+
+
+BirthdayList::Clock::Clock()
+{
+}
+
+BirthdayList::Clock::~Clock()
+{
+}
+
+QDate BirthdayList::Clock::currentDate() const
+{
+    return QDate::currentDate();
+}
+
+QDateTime BirthdayList::Clock::currentDateTime() const
+{
+    return QDateTime::currentDateTime();
+}
+
+BirthdayList::Clock *BirthdayList::Clock::systemClock()
+{
+    static Clock clock;
+    return &clock;
+}
+
+
+BirthdayList::SimulatedClock::SimulatedClock(const QDate &date)
+: m_date(date)
+{
+}
+
+BirthdayList::SimulatedClock::~SimulatedClock()
+{
+}
+
+QDate BirthdayList::SimulatedClock::currentDate() const
+{
+    return m_date;
+}
+
+QDateTime BirthdayList::SimulatedClock::currentDateTime() const
+{
+    return QDateTime(m_date, QTime(0, 0, 1));
+}
+
+void BirthdayList::SimulatedClock::setCurrentDate(const QDate &date)
+{
+    m_date = date;
+}
+
+void BirthdayList::SimulatedClock::advanceDays(int days)
+{
+    m_date = m_date.addDays(days);
+}
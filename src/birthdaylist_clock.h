@@ -0,0 +1,67 @@
+#ifndef BIRTHDAYLIST_CLOCK_H
+#define BIRTHDAYLIST_CLOCK_H
+
+/**
+ * @file    birthdaylist_clock.h
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include <QDateTime>
+
+
+namespace BirthdayList 
+{
+    /**
+    * Source of the current date and time for the model.
+    * The default implementation returns the system time.
+    */
+    class Clock
+    {
+    public:
+        Clock();
+        virtual ~Clock();
+
+        virtual QDate currentDate() const;
+        virtual QDateTime currentDateTime() const;
+
+        /** Returns the clock shared by all objects that use the system time. */
+        static Clock *systemClock();
+    };
+
+
+    /**
+    * Clock that stays at the given day until it is moved forward explicitly.
+    */
+    class SimulatedClock : public Clock
+    {
+    public:
+        explicit SimulatedClock(const QDate &date);
+        virtual ~SimulatedClock();
+
+        virtual QDate currentDate() const;
+        /** Returns the first second of the simulated day. */
+        virtual QDateTime currentDateTime() const;
+
+        void setCurrentDate(const QDate &date);
+        void advanceDays(int days);
+
+    private:
+        QDate m_date;
+    };
+};
+
+
+#endif //BIRTHDAYLIST_CLOCK_H
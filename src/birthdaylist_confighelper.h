@@ -19,56 +19,72 @@
  */
 
 
-#include "ui_birthdaylist_config_contacts.h"
-#include "ui_birthdaylist_config_events.h"
-#include "ui_birthdaylist_config_table.h"
-#include "ui_birthdaylist_config_colors.h"
-#include "birthdaylist_aboutdata.h"
+#include <KConfigGroup>
+#include <QHash>
 #include <QStringList>
+#include <QVariant>
 
 namespace BirthdayList {
-    class Model;
     class ModelConfiguration;
     class ViewConfiguration;
 };
-class KConfigDialog;
-class KConfigGroup;
 
 
 namespace BirthdayList
 {
-    class ConfigHelper : public QObject
+    /**
+    * Reads and writes the model and view configuration from/to the persistent storage
+    * (the configuration dialog is handled separately by ConfigUi).
+    */
+    class ConfigHelper
     {
-        Q_OBJECT
     public:
         ConfigHelper();
         ~ConfigHelper();
         
         void loadConfiguration(const KConfigGroup &configGroup, ModelConfiguration &modelConf, ViewConfiguration &viewConf);
-        void storeConfiguration(KConfigGroup &configGroup, const ModelConfiguration &modelConf, const ViewConfiguration &viewConf);
-        
-        void createConfigurationUI(KConfigDialog *parent, Model *model, const ModelConfiguration &modelConf, const ViewConfiguration &viewConf);
-        void updateConfigurationFromUI(ModelConfiguration &modelConf, ViewConfiguration &viewConf);
+        /** Writes only the entries that changed since the last call; returns true if any entry was written */
+        bool storeConfiguration(KConfigGroup &configGroup, const ModelConfiguration &modelConf, const ViewConfiguration &viewConf);
+
+        /** The diagnostics page is shown only if enabled by the "Show Diagnostics" entry (not editable in the UI) */
+        bool showDiagnostics() const {
+            return m_showDiagnostics;
+        }
+
+        /** Seconds of the session idle time after which the contacts are read if the popup in a panel has not been
+         *  opened yet (at the latest two minutes after startup), 0 reads them immediately; on the desktop they are
+         *  read shortly after startup (the "Start When Idle" entry, not editable in the UI) */
+        int startIdleSeconds() const {
+            return m_startIdleSeconds;
+        }
         
     private:
-        void readAvailableNamedayLists();
+        /** Writes the entry unless it has the value written by the last storeConfiguration */
+        template<typename T>
+        void writeEntry(KConfigGroup &configGroup, const char *key, const T &value) {
+            QVariant storedValue = QVariant::fromValue(value);
+            QHash<QString, QVariant>::const_iterator storedIt = m_storedEntries.constFind(key);
+            if (storedIt != m_storedEntries.constEnd() && storedIt.value() == storedValue) return;
+
+            if (!m_recordingStoredEntries) {
+                configGroup.writeEntry(key, value);
+                ++m_writtenEntries;
+            }
+            m_storedEntries.insert(key, storedValue);
+        }
+        void writeEntry(KConfigGroup &configGroup, const char *key, const char *value);
         
-        Ui::BirthdayListContactsConfig m_ui_contacts;
-        Ui::BirthdayListEventsConfig m_ui_events;
-        Ui::BirthdayListTableConfig m_ui_table;
-        Ui::BirthdayListColorsConfig m_ui_colors;
+        bool m_showDiagnostics;
+        int m_startIdleSeconds;
 
         QStringList m_obsoleteSelectableDateFormats;
         
-        QList<QString> m_namedayFiles;
-        QList<QString> m_namedayLangStrings;
-        
-    private slots:
-        /** Enables/disables some widgets in the configuration UI based on the current datasource selection */
-        void dataSourceChanged(const QString &name);
-        void namedayIdentificationChanged();
-        void namedayAnniversaryFieldSelected(bool checked);
-        void namedayCustomFieldSelected(bool checked);
+        /** Values of the entries as read by loadConfiguration or written by storeConfiguration */
+        QHash<QString, QVariant> m_storedEntries;
+        /** loadConfiguration only fills m_storedEntries with the values read, writeEntry doesn't write them */
+        bool m_recordingStoredEntries;
+        /** Number of the entries written by the current storeConfiguration */
+        int m_writtenEntries;
     };
 };
 
@@ -0,0 +1,357 @@
+/**
+ * @file    birthdaylist_configui.cpp
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_configui.h"
+#include "birthdaylist_diagnostics.h"
+#include "birthdaylist_model.h"
+#include "birthdaylist_trace.h"
+#include "birthdaylist_view.h"
+#include <KConfigDialog>
+#include <KFileDialog>
+#include <KStandardDirs>
+#include <QFile>
+
+
+QList<QString> BirthdayList::ConfigUi::m_namedayFiles;
+QList<QString> BirthdayList::ConfigUi::m_namedayLangStrings;
+
+BirthdayList::ConfigUi::ConfigUi()
+: m_model(0)
+{
+}
+
+BirthdayList::ConfigUi::~ConfigUi()
+{
+}
+
+void BirthdayList::ConfigUi::createConfigurationUI(KConfigDialog *parent, Model *model, bool showDiagnostics, const ModelConfiguration &modelConf, const ViewConfiguration &viewConf)
+{
+    m_model = model;
+    // the catalogue is discovered only when it is needed for the first time, it is shared by all the applet instances
+    if (m_namedayFiles.isEmpty()) readAvailableNamedayLists();
+
+    QWidget *contactsWidget = new QWidget;
+    QWidget *eventsWidget = new QWidget;
+    QWidget *tableWidget = new QWidget;
+    QWidget *colorsWidget = new QWidget;
+
+    m_ui_contacts.setupUi(contactsWidget);
+    m_ui_events.setupUi(eventsWidget);
+    m_ui_table.setupUi(tableWidget);
+    m_ui_colors.setupUi(colorsWidget);
+
+    parent->setButtons(KDialog::Ok | KDialog::Cancel);
+    parent->addPage(contactsWidget, i18n("Contacts"), "system-users");
+    parent->addPage(eventsWidget, i18n("Events"), "bl_date");
+    parent->addPage(tableWidget, i18n("Table"), "view-form-table");
+    parent->addPage(colorsWidget, i18n("Colors"), "preferences-desktop-color");
+
+    if (showDiagnostics) {
+        QWidget *diagnosticsWidget = new QWidget;
+        m_ui_diagnostics.setupUi(diagnosticsWidget);
+        parent->addPage(diagnosticsWidget, i18n("Diagnostics"), "utilities-system-monitor");
+
+        refreshDiagnostics();
+        connect(m_ui_diagnostics.btnRefreshDiagnostics, SIGNAL(clicked()), this, SLOT(refreshDiagnostics()));
+        connect(m_ui_diagnostics.btnExportDiagnostics, SIGNAL(clicked()), this, SLOT(exportDiagnostics()));
+    }
+
+    m_ui_contacts.cmbDataSource->clear();
+    /*m_ui_contacts.cmbDataSource->addItem(i18n("KDE Address Book"), QVariant("KABC"));
+    if (modelConf.eventDataSource == ModelConfiguration::EDS_KABC) m_ui_contacts.cmbDataSource->setCurrentIndex(m_ui_contacts.cmbDataSource->count()-1);*/
+
+    m_ui_contacts.cmbDataSource->addItem(i18n("Akonadi"), QVariant("Akonadi"));
+    if (modelConf.eventDataSource == ModelConfiguration::EDS_Akonadi) m_ui_contacts.cmbDataSource->setCurrentIndex(m_ui_contacts.cmbDataSource->count()-1);
+
+    dataSourceChanged(m_ui_contacts.cmbDataSource->currentText());
+
+    m_ui_contacts.cmbAkoCollection->clear();
+    QHash<QString, int> akonadiCollections = model->getAkonadiCollections();
+    QHashIterator<QString, int> collectionsIt(akonadiCollections);
+    while (collectionsIt.hasNext()) {
+        collectionsIt.next();
+        QString collectionName = collectionsIt.key();
+        int collectionId = collectionsIt.value();
+        m_ui_contacts.cmbAkoCollection->addItem(collectionName, collectionId);
+        if (collectionId == modelConf.akonadiCollectionId) {
+            m_ui_contacts.cmbAkoCollection->setCurrentIndex(m_ui_contacts.cmbAkoCollection->count()-1);
+        }
+    }
+    if (m_ui_contacts.cmbAkoCollection->count() == 0) {
+        m_ui_contacts.cmbAkoCollection->addItem(i18nc("No Akonadi collections", "No collections available"));
+        m_ui_contacts.cmbAkoCollection->setEnabled(false);
+    }
+    else m_ui_contacts.cmbAkoCollection->setEnabled(true);
+
+    m_ui_events.chckNamedayAnniversaryField->setChecked(modelConf.namedayByAnniversaryDateField);
+    m_ui_events.chckNamedayCustomDateField->setChecked(modelConf.namedayByCustomDateField);
+    m_ui_events.lineEditNamedayCustomDateField->setText(modelConf.namedayCustomDateFieldName);
+    m_ui_events.chckNamedayNameField->setChecked(modelConf.namedayByGivenName);
+
+    m_ui_table.chckShowColumnHeaders->setChecked(viewConf.showColumnHeaders);
+    m_ui_table.chckShowColName->setChecked(viewConf.showColName);
+    m_ui_table.chckShowColAge->setChecked(viewConf.showColAge);
+    m_ui_table.chckShowColDate->setChecked(viewConf.showColDate);
+    m_ui_table.chckShowColWhen->setChecked(viewConf.showColWhen);
+
+    m_ui_table.chckShowNicknames->setChecked(modelConf.showNicknames);
+    m_ui_table.leDateDisplayFormat->setText(modelConf.dateFormat);
+    if (modelConf.textAlignmentLeft) m_ui_table.rbTextAlignmentLeft->setChecked(true);
+    else m_ui_table.rbTextAlignmentRight->setChecked(true);
+
+    m_ui_events.chckShowNamedays->setChecked(modelConf.showNamedays);
+    m_ui_events.rbNamedayShowIndEvents->setChecked(modelConf.namedayDisplayMode == ModelConfiguration::NDM_IndividualEvents);
+    m_ui_events.rbNamedayShowAllFromCal->setChecked(modelConf.namedayDisplayMode == ModelConfiguration::NDM_AllCalendarNames);
+    m_ui_events.rbNamedayShowAggrEvents->setChecked(modelConf.namedayDisplayMode == ModelConfiguration::NDM_AggregateEvents);
+
+    m_ui_events.cmbNamedayCalendar->clear();
+    m_ui_events.cmbNamedayCalendar->addItems(m_namedayLangStrings);
+    if (m_namedayFiles.contains(modelConf.curNamedayFile)) {
+        m_ui_events.cmbNamedayCalendar->setCurrentIndex(m_namedayFiles.indexOf(modelConf.curNamedayFile));
+    } else m_ui_events.cmbNamedayCalendar->setCurrentIndex(0);
+    m_ui_events.chckShowAnniversaries->setChecked(modelConf.showAnniversaries);
+    
+    m_ui_contacts.rbFilterTypeOff->setChecked(modelConf.filterType == ModelConfiguration::FT_Off);
+    m_ui_contacts.rbFilterTypeCategory->setChecked(modelConf.filterType == ModelConfiguration::FT_Category);
+    m_ui_contacts.rbFilterTypeCustomFieldName->setChecked(modelConf.filterType == ModelConfiguration::FT_CustomField);
+    m_ui_contacts.rbFilterTypeCustomFieldPrefix->setChecked(modelConf.filterType == ModelConfiguration::FT_CustomFieldPrefix);
+    m_ui_contacts.lineEditCustomFieldName->setText(modelConf.customFieldName);
+    m_ui_contacts.lineEditCustomFieldPrefix->setText(modelConf.customFieldPrefix);
+    m_ui_contacts.lineEditFilterValue->setText(modelConf.filterValue);
+
+    m_ui_colors.chckTodaysForeground->setChecked(modelConf.todayColorSettings.isForeground);
+    m_ui_colors.colorbtnTodaysForeground->setColor(modelConf.todayColorSettings.brushForeground.color());
+    m_ui_colors.chckTodaysBackground->setChecked(modelConf.todayColorSettings.isBackground);
+    m_ui_colors.colorbtnTodaysBackground->setColor(modelConf.todayColorSettings.brushBackground.color());
+    m_ui_colors.chckTodaysHighlightNoEvent->setChecked(modelConf.todayColorSettings.highlightNoEvents);
+
+    m_ui_events.spinComingShowDays->setValue(modelConf.eventThreshold);
+    m_ui_colors.spinComingHighlightDays->setValue(modelConf.highlightThreshold);
+    m_ui_colors.chckComingHighlightForeground->setChecked(modelConf.highlightColorSettings.isForeground);
+    m_ui_colors.colorbtnComingHighlightForeground->setColor(modelConf.highlightColorSettings.brushForeground.color());
+    m_ui_colors.chckComingHighlightBackground->setChecked(modelConf.highlightColorSettings.isBackground);
+    m_ui_colors.colorbtnComingHighlightBackground->setColor(modelConf.highlightColorSettings.brushBackground.color());
+    m_ui_colors.chckComingHighlightNoEvent->setChecked(modelConf.highlightColorSettings.highlightNoEvents);
+
+    m_ui_events.spinPastShowDays->setValue(modelConf.pastThreshold);
+    m_ui_colors.chckPastForeground->setChecked(modelConf.pastColorSettings.isForeground);
+    m_ui_colors.colorbtnPastForeground->setColor(modelConf.pastColorSettings.brushForeground.color());
+    m_ui_colors.chckPastBackground->setChecked(modelConf.pastColorSettings.isBackground);
+    m_ui_colors.colorbtnPastBackground->setColor(modelConf.pastColorSettings.brushBackground.color());
+    m_ui_colors.chckPastHighlightNoEvent->setChecked(modelConf.pastColorSettings.highlightNoEvents);
+    
+    // enable only relevant widgets
+    namedayIdentificationChanged();
+
+    connect(m_ui_contacts.cmbDataSource, SIGNAL(currentIndexChanged(QString)), this, SLOT(dataSourceChanged(QString)));
+    connect(m_ui_events.chckShowNamedays, SIGNAL(toggled(bool)), this, SLOT(namedayIdentificationChanged()));
+    connect(m_ui_events.chckNamedayAnniversaryField, SIGNAL(toggled(bool)), this, SLOT(namedayIdentificationChanged()));
+    connect(m_ui_events.chckNamedayCustomDateField, SIGNAL(toggled(bool)), this, SLOT(namedayIdentificationChanged()));
+    connect(m_ui_events.chckNamedayNameField, SIGNAL(toggled(bool)), this, SLOT(namedayIdentificationChanged()));
+    
+    connect(m_ui_events.chckNamedayAnniversaryField, SIGNAL(toggled(bool)), this, SLOT(namedayAnniversaryFieldSelected(bool)));
+    connect(m_ui_events.chckNamedayCustomDateField, SIGNAL(toggled(bool)), this, SLOT(namedayCustomFieldSelected(bool)));
+}
+
+void BirthdayList::ConfigUi::updateConfigurationFromUI(ModelConfiguration &modelConf, ViewConfiguration &viewConf)
+{
+    QString selectedDataSource;
+    if (m_ui_contacts.cmbDataSource->count() > 0) {
+        selectedDataSource = m_ui_contacts.cmbDataSource->itemText(m_ui_contacts.cmbDataSource->currentIndex());
+    }
+    /*if (selectedDataSource == "Akonadi") modelConf.eventDataSource = ModelConfiguration::EDS_Akonadi;
+    else modelConf.eventDataSource = ModelConfiguration::EDS_KABC;*/
+    modelConf.eventDataSource = ModelConfiguration::EDS_Akonadi;
+
+    if (m_ui_contacts.cmbAkoCollection->isEnabled()) {
+        modelConf.akonadiCollectionId = m_ui_contacts.cmbAkoCollection->itemData(m_ui_contacts.cmbAkoCollection->currentIndex()).toInt();
+    }
+    else modelConf.akonadiCollectionId = -1;
+
+    modelConf.namedayByAnniversaryDateField = m_ui_events.chckNamedayAnniversaryField->isChecked();
+    modelConf.namedayByCustomDateField = m_ui_events.chckNamedayCustomDateField->isChecked();
+    modelConf.namedayCustomDateFieldName = m_ui_events.lineEditNamedayCustomDateField->text();
+    modelConf.namedayByGivenName = m_ui_events.chckNamedayNameField->isChecked();
+
+    viewConf.showColumnHeaders = m_ui_table.chckShowColumnHeaders->isChecked();
+    viewConf.showColName = m_ui_table.chckShowColName->isChecked();
+    viewConf.showColAge = m_ui_table.chckShowColAge->isChecked();
+    viewConf.showColDate = m_ui_table.chckShowColDate->isChecked();
+    viewConf.showColWhen = m_ui_table.chckShowColWhen->isChecked();
+
+    modelConf.showNicknames = m_ui_table.chckShowNicknames->isChecked();
+    modelConf.dateFormat = m_ui_table.leDateDisplayFormat->text();
+    modelConf.textAlignmentLeft = m_ui_table.rbTextAlignmentLeft->isChecked();
+
+    modelConf.showNamedays = m_ui_events.chckShowNamedays->isChecked();
+    modelConf.curNamedayFile = m_namedayFiles[m_ui_events.cmbNamedayCalendar->currentIndex()];
+    if (m_ui_events.rbNamedayShowIndEvents->isChecked()) modelConf.namedayDisplayMode = ModelConfiguration::NDM_IndividualEvents;
+    else if (m_ui_events.rbNamedayShowAllFromCal->isChecked()) modelConf.namedayDisplayMode = ModelConfiguration::NDM_AllCalendarNames;
+    else modelConf.namedayDisplayMode = ModelConfiguration::NDM_AggregateEvents;
+
+    modelConf.showAnniversaries = m_ui_events.chckShowAnniversaries->isChecked();
+    
+    if (m_ui_contacts.rbFilterTypeCategory->isChecked()) modelConf.filterType = ModelConfiguration::FT_Category;
+    else if (m_ui_contacts.rbFilterTypeCustomFieldName->isChecked()) modelConf.filterType = ModelConfiguration::FT_CustomField;
+    else if (m_ui_contacts.rbFilterTypeCustomFieldPrefix->isChecked()) modelConf.filterType = ModelConfiguration::FT_CustomFieldPrefix;
+    else modelConf.filterType = ModelConfiguration::FT_Off;
+    modelConf.customFieldName = m_ui_contacts.lineEditCustomFieldName->text();
+    modelConf.customFieldPrefix = m_ui_contacts.lineEditCustomFieldPrefix->text();
+    modelConf.filterValue = m_ui_contacts.lineEditFilterValue->text();
+
+    modelConf.todayColorSettings.isForeground = m_ui_colors.chckTodaysForeground->isChecked();
+    modelConf.todayColorSettings.brushForeground.setColor(m_ui_colors.colorbtnTodaysForeground->color());
+    modelConf.todayColorSettings.isBackground = m_ui_colors.chckTodaysBackground->isChecked();
+    modelConf.todayColorSettings.brushBackground.setColor(m_ui_colors.colorbtnTodaysBackground->color());
+    modelConf.todayColorSettings.highlightNoEvents = m_ui_colors.chckTodaysHighlightNoEvent->isChecked();
+
+    modelConf.eventThreshold = m_ui_events.spinComingShowDays->value();
+    modelConf.highlightThreshold = m_ui_colors.spinComingHighlightDays->value();
+    modelConf.highlightColorSettings.isForeground = m_ui_colors.chckComingHighlightForeground->isChecked();
+    modelConf.highlightColorSettings.brushForeground.setColor(m_ui_colors.colorbtnComingHighlightForeground->color());
+    modelConf.highlightColorSettings.isBackground = m_ui_colors.chckComingHighlightBackground->isChecked();
+    modelConf.highlightColorSettings.brushBackground.setColor(m_ui_colors.colorbtnComingHighlightBackground->color());
+    modelConf.highlightColorSettings.highlightNoEvents = m_ui_colors.chckComingHighlightNoEvent->isChecked();
+
+    modelConf.pastThreshold = m_ui_events.spinPastShowDays->value();
+    modelConf.pastColorSettings.isForeground = m_ui_colors.chckPastForeground->isChecked();
+    modelConf.pastColorSettings.brushForeground.setColor(m_ui_colors.colorbtnPastForeground->color());
+    modelConf.pastColorSettings.isBackground = m_ui_colors.chckPastBackground->isChecked();
+    modelConf.pastColorSettings.brushBackground.setColor(m_ui_colors.colorbtnPastBackground->color());
+    modelConf.pastColorSettings.highlightNoEvents = m_ui_colors.chckPastHighlightNoEvent->isChecked();
+}
+
+void BirthdayList::ConfigUi::dataSourceChanged(const QString &name) 
+{
+    m_ui_contacts.lblAkoCollection->setVisible(name == "Akonadi");
+    m_ui_contacts.cmbAkoCollection->setVisible(name == "Akonadi");
+}
+
+void BirthdayList::ConfigUi::namedayIdentificationChanged()
+{
+    bool namedaysEnabled = m_ui_events.chckShowNamedays->isChecked();
+    bool namedayCustomDateField = m_ui_events.chckNamedayCustomDateField->isChecked();
+    m_ui_events.lineEditNamedayCustomDateField->setEnabled(namedaysEnabled && namedayCustomDateField);
+}
+
+void BirthdayList::ConfigUi::namedayAnniversaryFieldSelected(bool checked)
+{
+    if (checked) m_ui_events.chckNamedayCustomDateField->setChecked(false);
+}
+
+void BirthdayList::ConfigUi::namedayCustomFieldSelected(bool checked)
+{
+    if (checked) m_ui_events.chckNamedayAnniversaryField->setChecked(false);
+}
+
+void BirthdayList::ConfigUi::refreshDiagnostics()
+{
+    Diagnostics *diagnostics = Diagnostics::instance();
+    if (m_model) m_model->reportMemoryUsage();
+
+    m_ui_diagnostics.treeStages->clear();
+    QMapIterator<QString, Diagnostics::StageStatistics> stageIt(diagnostics->stages());
+    while (stageIt.hasNext()) {
+        stageIt.next();
+        const Diagnostics::StageStatistics &statistics = stageIt.value();
+        QStringList columns;
+        columns << stageIt.key() << QString::number(statistics.last() / 1000.0, 'f', 2)
+                << QString::number(statistics.average() / 1000.0, 'f', 2)
+                << QString::number(statistics.percentile(99) / 1000.0, 'f', 2) << QString::number(statistics.count());
+        m_ui_diagnostics.treeStages->addTopLevelItem(new QTreeWidgetItem(columns));
+    }
+
+    m_ui_diagnostics.treeCounters->clear();
+    QMapIterator<QString, qint64> counterIt(diagnostics->counters());
+    while (counterIt.hasNext()) {
+        counterIt.next();
+        m_ui_diagnostics.treeCounters->addTopLevelItem(new QTreeWidgetItem(QStringList() << counterIt.key() << QString::number(counterIt.value())));
+    }
+
+    m_ui_diagnostics.treeSlots->clear();
+    QMapIterator<QString, Diagnostics::SlotHistogram> slotIt(diagnostics->slotHistograms());
+    while (slotIt.hasNext()) {
+        slotIt.next();
+        const Diagnostics::SlotHistogram &histogram = slotIt.value();
+        QStringList buckets;
+        for (int i=0; i<histogram.buckets().size(); ++i) {
+            if (histogram.buckets()[i] == 0) continue;
+            int bound = Diagnostics::SlotHistogram::bucketBound(i);
+            QString bucketName = bound >= 0 ? QString("<%1").arg(bound) : QString(">=%1").arg(Diagnostics::SlotHistogram::bucketBound(i - 1));
+            buckets << QString("%1: %2").arg(bucketName).arg(histogram.buckets()[i]);
+        }
+
+        QStringList columns;
+        columns << slotIt.key() << QString::number(histogram.count()) << QString::number(histogram.overBudgetCount())
+                << QString::number(histogram.maximum() / 1000.0, 'f', 2) << buckets.join(", ");
+        m_ui_diagnostics.treeSlots->addTopLevelItem(new QTreeWidgetItem(columns));
+    }
+
+    m_ui_diagnostics.treeMilestones->clear();
+    qint64 previousMilestone = 0;
+    typedef QPair<QString, qint64> Milestone;
+    foreach (const Milestone &milestone, diagnostics->milestones()) {
+        QStringList columns;
+        columns << milestone.first << QString::number(milestone.second / 1000.0, 'f', 2)
+                << QString::number((milestone.second - previousMilestone) / 1000.0, 'f', 2);
+        m_ui_diagnostics.treeMilestones->addTopLevelItem(new QTreeWidgetItem(columns));
+        previousMilestone = milestone.second;
+    }
+}
+
+void BirthdayList::ConfigUi::exportDiagnostics()
+{
+    QString fileName = KFileDialog::getSaveFileName(KUrl(), "*.json", m_ui_diagnostics.btnExportDiagnostics, i18n("Export Diagnostics"));
+    if (fileName.isEmpty()) return;
+
+    if (m_model) m_model->reportMemoryUsage();
+    Diagnostics::instance()->exportJson(fileName);
+}
+
+void BirthdayList::ConfigUi::readAvailableNamedayLists() 
+{
+    BL_TRACE_SPAN(TC_Applet, "readAvailableNamedayLists");
+    QStringList fileNames = KGlobal::dirs()->findAllResources("data", "birthdaylist/namedaydefs/namedays_*.txt");
+    if (fileNames.isEmpty()) {
+        kDebug() << "Couldn't find any nameday list files";
+    }
+
+    foreach(QString fileName, fileNames) {
+        int langPos = fileName.lastIndexOf("/namedays_") + 10;
+        QString namedayDefinitionKey = fileName.mid(langPos);
+        namedayDefinitionKey.chop(4);
+
+        QString languageName;
+        QFile namedayFile(fileName);
+        if (namedayFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            QTextStream stream(&namedayFile);
+            languageName =  stream.readLine();
+            namedayFile.close();
+        } else {
+            kDebug() << "Cannot read language string from " << fileName;
+            continue;
+        }
+        
+        kDebug() << "Registering nameday file" << fileName << "for language" << languageName;
+        m_namedayFiles.append(fileName);
+        m_namedayLangStrings.append(languageName);
+    }
+
+    m_namedayFiles.prepend("");
+    m_namedayLangStrings.prepend(i18nc("No nameday calendar (combo box item)", "None"));
+}
@@ -0,0 +1,84 @@
+#ifndef BIRTHDAYLIST_CONFIGUI_H
+#define BIRTHDAYLIST_CONFIGUI_H
+
+/**
+ * @file    birthdaylist_configui.h
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+
+#include "ui_birthdaylist_config_contacts.h"
+#include "ui_birthdaylist_config_events.h"
+#include "ui_birthdaylist_config_table.h"
+#include "ui_birthdaylist_config_colors.h"
+#include "ui_birthdaylist_config_diagnostics.h"
+#include <QObject>
+#include <QStringList>
+
+namespace BirthdayList {
+    class Model;
+    class ModelConfiguration;
+    class ViewConfiguration;
+};
+class KConfigDialog;
+
+
+namespace BirthdayList
+{
+    /**
+    * Fills the configuration dialog with the model and view configuration and reads the changes back
+    * (created only when the dialog is opened for the first time).
+    */
+    class ConfigUi : public QObject
+    {
+        Q_OBJECT
+    public:
+        ConfigUi();
+        ~ConfigUi();
+        
+        void createConfigurationUI(KConfigDialog *parent, Model *model, bool showDiagnostics, const ModelConfiguration &modelConf, const ViewConfiguration &viewConf);
+        void updateConfigurationFromUI(ModelConfiguration &modelConf, ViewConfiguration &viewConf);
+        
+    private:
+        /** Finds the installed nameday calendars and reads their language names */
+        void readAvailableNamedayLists();
+        
+        Ui::BirthdayListContactsConfig m_ui_contacts;
+        Ui::BirthdayListEventsConfig m_ui_events;
+        Ui::BirthdayListTableConfig m_ui_table;
+        Ui::BirthdayListColorsConfig m_ui_colors;
+        Ui::BirthdayListDiagnosticsConfig m_ui_diagnostics;
+        /** Model shown by the configuration dialog (its memory usage is reported on the diagnostics page) */
+        Model *m_model;
+
+        /** Nameday calendars installed in the data dirs (read once and shared by all the applet instances) */
+        static QList<QString> m_namedayFiles;
+        static QList<QString> m_namedayLangStrings;
+        
+    private slots:
+        /** Enables/disables some widgets in the configuration UI based on the current datasource selection */
+        void dataSourceChanged(const QString &name);
+        void namedayIdentificationChanged();
+        void namedayAnniversaryFieldSelected(bool checked);
+        void namedayCustomFieldSelected(bool checked);
+        /** Fills the diagnostics page with the current statistics */
+        void refreshDiagnostics();
+        void exportDiagnostics();
+    };
+};
+
+
+#endif //BIRTHDAYLIST_CONFIGUI_H
\ No newline at end of file
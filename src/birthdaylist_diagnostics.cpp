@@ -0,0 +1,275 @@
+/**
+ * @file    birthdaylist_diagnostics.cpp
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_diagnostics.h"
+#include <KDebug>
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+
+
+BirthdayList::Diagnostics::StageStatistics::StageStatistics()
+: m_last(0),
+m_total(0),
+m_count(0),
+m_nextRecent(0)
+{
+}
+
+void BirthdayList::Diagnostics::StageStatistics::add(qint64 usecs)
+{
+    m_last = usecs;
+    m_total += usecs;
+    ++m_count;
+
+    if (m_recent.size() < m_recentSize) m_recent.append(usecs);
+    else m_recent[m_nextRecent] = usecs;
+    m_nextRecent = (m_nextRecent + 1) % m_recentSize;
+}
+
+qint64 BirthdayList::Diagnostics::StageStatistics::average() const
+{
+    return m_count > 0 ? m_total / m_count : 0;
+}
+
+qint64 BirthdayList::Diagnostics::StageStatistics::percentile(int percentile) const
+{
+    if (m_recent.isEmpty()) return 0;
+
+    QVector<qint64> sortedSamples = m_recent;
+    qSort(sortedSamples);
+    int index = qBound(0, (sortedSamples.size() * percentile + 99) / 100 - 1, sortedSamples.size() - 1);
+    return sortedSamples[index];
+}
+
+
+BirthdayList::Diagnostics::SlotHistogram::SlotHistogram()
+: m_buckets(m_bucketCount, 0),
+m_count(0),
+m_overBudgetCount(0),
+m_maximum(0)
+{
+}
+
+void BirthdayList::Diagnostics::SlotHistogram::add(qint64 usecs, bool overBudget)
+{
+    int bucket = 0;
+    while (bucket < m_bucketCount - 1 && usecs >= qint64(bucketBound(bucket)) * 1000) ++bucket;
+    ++m_buckets[bucket];
+
+    ++m_count;
+    if (overBudget) ++m_overBudgetCount;
+    m_maximum = qMax(m_maximum, usecs);
+}
+
+int BirthdayList::Diagnostics::SlotHistogram::bucketBound(int bucket)
+{
+    return bucket < m_bucketCount - 1 ? 1 << bucket : -1;
+}
+
+
+BirthdayList::Diagnostics::Diagnostics()
+{
+    // the diagnostics are created by the first milestone, which makes it the origin of the startup profile
+    m_milestoneClock.start();
+}
+
+BirthdayList::Diagnostics *BirthdayList::Diagnostics::instance()
+{
+    static Diagnostics diagnostics;
+    return &diagnostics;
+}
+
+void BirthdayList::Diagnostics::recordStage(const QString &stage, qint64 usecs)
+{
+    m_stages[stage].add(usecs);
+}
+
+void BirthdayList::Diagnostics::setCounter(const QString &counter, qint64 value)
+{
+    m_counters[counter] = value;
+}
+
+void BirthdayList::Diagnostics::incrementCounter(const QString &counter, qint64 increment)
+{
+    m_counters[counter] += increment;
+}
+
+void BirthdayList::Diagnostics::recordSlot(const QString &slot, qint64 usecs, bool overBudget)
+{
+    m_slotHistograms[slot].add(usecs, overBudget);
+}
+
+bool BirthdayList::Diagnostics::recordMilestone(const char *milestone)
+{
+    QString name = QString::fromLatin1(milestone);
+    for (int i=0; i<m_milestones.size(); ++i) {
+        if (m_milestones[i].first == name) return false;
+    }
+
+    m_milestones.append(qMakePair(name, m_milestoneClock.nsecsElapsed() / 1000));
+    return true;
+}
+
+void BirthdayList::Diagnostics::restartMilestones()
+{
+    m_milestones.clear();
+    m_milestoneClock.restart();
+}
+
+QString BirthdayList::Diagnostics::milestoneSummary() const
+{
+    QStringList milestones;
+    for (int i=0; i<m_milestones.size(); ++i) {
+        milestones.append(QString("%1 %2 ms").arg(m_milestones[i].first).arg(m_milestones[i].second / 1000.0, 0, 'f', 1));
+    }
+    return milestones.join(", ");
+}
+
+QString BirthdayList::Diagnostics::toJson() const
+{
+    QString json;
+    QTextStream stream(&json);
+
+    stream << "{\n  \"stages\": {";
+    QMapIterator<QString, StageStatistics> stageIt(m_stages);
+    bool first = true;
+    while (stageIt.hasNext()) {
+        stageIt.next();
+        const StageStatistics &statistics = stageIt.value();
+        stream << (first ? "\n" : ",\n") << "    \"" << stageIt.key() << "\": { \"last_us\": " << statistics.last()
+               << ", \"average_us\": " << statistics.average() << ", \"p99_us\": " << statistics.percentile(99)
+               << ", \"count\": " << statistics.count() << " }";
+        first = false;
+    }
+    stream << "\n  },\n  \"counters\": {";
+
+    QMapIterator<QString, qint64> counterIt(m_counters);
+    first = true;
+    while (counterIt.hasNext()) {
+        counterIt.next();
+        stream << (first ? "\n" : ",\n") << "    \"" << counterIt.key() << "\": " << counterIt.value();
+        first = false;
+    }
+    stream << "\n  },\n  \"slots\": {";
+
+    QMapIterator<QString, SlotHistogram> slotIt(m_slotHistograms);
+    first = true;
+    while (slotIt.hasNext()) {
+        slotIt.next();
+        const SlotHistogram &histogram = slotIt.value();
+        stream << (first ? "\n" : ",\n") << "    \"" << slotIt.key() << "\": { \"count\": " << histogram.count()
+               << ", \"over_budget\": " << histogram.overBudgetCount() << ", \"max_us\": " << histogram.maximum()
+               << ", \"histogram_ms\": {";
+        for (int i=0; i<histogram.buckets().size(); ++i) {
+            int bound = SlotHistogram::bucketBound(i);
+            stream << (i > 0 ? ", " : " ") << "\"" << (bound >= 0 ? QString("<%1").arg(bound) : QString(">=%1").arg(SlotHistogram::bucketBound(i - 1)))
+                   << "\": " << histogram.buckets()[i];
+        }
+        stream << " } }";
+        first = false;
+    }
+    stream << "\n  },\n  \"milestones\": [";
+
+    for (int i=0; i<m_milestones.size(); ++i) {
+        stream << (i > 0 ? ",\n" : "\n") << "    { \"milestone\": \"" << m_milestones[i].first << "\", \"us\": " << m_milestones[i].second << " }";
+    }
+    stream << "\n  ]\n}\n";
+
+    stream.flush();
+    return json;
+}
+
+bool BirthdayList::Diagnostics::exportJson(const QString &fileName) const
+{
+    QFile exportFile(fileName);
+    if (!exportFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        kWarning() << "Cannot export the diagnostics to" << fileName;
+        return false;
+    }
+
+    QTextStream stream(&exportFile);
+    stream << toJson();
+    return true;
+}
+
+
+BirthdayList::DiagnosticsTimer::DiagnosticsTimer(const char *stage)
+: m_stage(stage)
+{
+    m_timer.start();
+}
+
+BirthdayList::DiagnosticsTimer::~DiagnosticsTimer()
+{
+    stop();
+}
+
+void BirthdayList::DiagnosticsTimer::stop()
+{
+    if (m_stage == 0) return;
+
+    Diagnostics::instance()->recordStage(m_stage, m_timer.nsecsElapsed() / 1000);
+    m_stage = 0;
+}
+
+
+qint64 BirthdayList::SlotWatchdog::m_budgetUsecs = 16000;
+const qint64 BirthdayList::SlotWatchdog::m_warningIntervalMsecs;
+QElapsedTimer BirthdayList::SlotWatchdog::m_warningClock;
+QHash<const char*, BirthdayList::SlotWatchdog::StallWarnings> BirthdayList::SlotWatchdog::m_stallWarnings;
+QList<BirthdayList::SlotWatchdog*> BirthdayList::SlotWatchdog::m_activeWatchdogs;
+
+BirthdayList::SlotWatchdog::SlotWatchdog(const char *slot)
+: m_slot(slot),
+m_stallReported(false)
+{
+    m_activeWatchdogs.append(this);
+    m_timer.start();
+}
+
+BirthdayList::SlotWatchdog::~SlotWatchdog()
+{
+    qint64 usecs = m_timer.nsecsElapsed() / 1000;
+    bool overBudget = usecs > m_budgetUsecs;
+    Diagnostics::instance()->recordSlot(m_slot, usecs, overBudget);
+
+    if (overBudget && !m_stallReported) {
+        if (!m_warningClock.isValid()) m_warningClock.start();
+        qint64 nowMsecs = m_warningClock.elapsed();
+
+        // the slot names are string literals, one per watched slot
+        StallWarnings &warnings = m_stallWarnings[m_slot];
+        if (nowMsecs - warnings.lastWarningMsecs >= m_warningIntervalMsecs) {
+            QStringList slotChain;
+            foreach (const SlotWatchdog *watchdog, m_activeWatchdogs) slotChain.append(watchdog->m_slot);
+            kWarning() << "Slot" << m_slot << "blocked the event loop for" << usecs / 1000.0 << "ms (budget"
+                       << m_budgetUsecs / 1000 << "ms), in" << slotChain.join(" > ")
+                       << "-" << warnings.unloggedStalls << "stalls not logged since the previous warning";
+            warnings.lastWarningMsecs = nowMsecs;
+            warnings.unloggedStalls = 0;
+        } else {
+            ++warnings.unloggedStalls;
+        }
+
+        // the slots calling this one stalled because of it
+        foreach (SlotWatchdog *watchdog, m_activeWatchdogs) watchdog->m_stallReported = true;
+    }
+
+    m_activeWatchdogs.removeLast();
+}
@@ -0,0 +1,203 @@
+#ifndef BIRTHDAYLIST_DIAGNOSTICS_H
+#define BIRTHDAYLIST_DIAGNOSTICS_H
+
+/**
+ * @file    birthdaylist_diagnostics.h
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+
+namespace BirthdayList 
+{
+    /**
+    * Collects the durations of the processing stages and the values of counters of the whole applet
+    * (shown on the hidden Diagnostics page of the configuration dialog, see ConfigHelper).
+    * Recording a stage costs a map lookup, so the stages must not be recorded per contact.
+    */
+    class Diagnostics
+    {
+    public:
+        /** Durations of one stage in microseconds */
+        class StageStatistics
+        {
+        public:
+            StageStatistics();
+
+            void add(qint64 usecs);
+
+            qint64 last() const {
+                return m_last;
+            }
+            qint64 average() const;
+            /** Returns the given percentile of the recent samples */
+            qint64 percentile(int percentile) const;
+            int count() const {
+                return m_count;
+            }
+
+        private:
+            qint64 m_last;
+            qint64 m_total;
+            int m_count;
+            /** Ring buffer of the recent samples (used for the percentiles) */
+            QVector<qint64> m_recent;
+            int m_nextRecent;
+            static const int m_recentSize = 256;
+        };
+
+        /** Histogram of the durations of one slot, the bucket i counts the durations shorter than 2^i ms
+        *  (the last bucket counts all longer durations) */
+        class SlotHistogram
+        {
+        public:
+            SlotHistogram();
+
+            void add(qint64 usecs, bool overBudget);
+
+            const QVector<int>& buckets() const {
+                return m_buckets;
+            }
+            /** Returns the upper bound of the given bucket in milliseconds (-1 for the last bucket) */
+            static int bucketBound(int bucket);
+            int count() const {
+                return m_count;
+            }
+            int overBudgetCount() const {
+                return m_overBudgetCount;
+            }
+            qint64 maximum() const {
+                return m_maximum;
+            }
+
+        private:
+            QVector<int> m_buckets;
+            int m_count;
+            int m_overBudgetCount;
+            qint64 m_maximum;
+            static const int m_bucketCount = 10;
+        };
+
+        /** Returns the diagnostics shared by all components of the applet */
+        static Diagnostics *instance();
+
+        void recordStage(const QString &stage, qint64 usecs);
+        void setCounter(const QString &counter, qint64 value);
+        void incrementCounter(const QString &counter, qint64 increment = 1);
+        void recordSlot(const QString &slot, qint64 usecs, bool overBudget);
+
+        const QMap<QString, StageStatistics>& stages() const {
+            return m_stages;
+        }
+        const QMap<QString, qint64>& counters() const {
+            return m_counters;
+        }
+        const QMap<QString, SlotHistogram>& slotHistograms() const {
+            return m_slotHistograms;
+        }
+
+        /** Records the time of the given startup milestone since the diagnostics were created; only the first
+        *  occurrence is recorded (so that the first applet of the process is profiled), returns true if it was */
+        bool recordMilestone(const char *milestone);
+        /** Forgets the milestones and restarts their clock (used by StartupBenchmark) */
+        void restartMilestones();
+
+        /** Returns the milestones in the order of their occurrence with their times in microseconds */
+        const QList<QPair<QString, qint64> >& milestones() const {
+            return m_milestones;
+        }
+        /** Returns the milestones as one line of text (used for the log) */
+        QString milestoneSummary() const;
+
+        /** Returns all statistics, counters and milestones in the JSON format */
+        QString toJson() const;
+        bool exportJson(const QString &fileName) const;
+
+    private:
+        Diagnostics();
+
+        QMap<QString, StageStatistics> m_stages;
+        QMap<QString, qint64> m_counters;
+        QMap<QString, SlotHistogram> m_slotHistograms;
+        QElapsedTimer m_milestoneClock;
+        QList<QPair<QString, qint64> > m_milestones;
+    };
+
+
+    /**
+    * Records the time from its construction to its destruction (or to stop()) as a duration of the given stage.
+    */
+    class DiagnosticsTimer
+    {
+    public:
+        explicit DiagnosticsTimer(const char *stage);
+        ~DiagnosticsTimer();
+
+        /** Records the duration now (the destruction then records nothing) */
+        void stop();
+
+    private:
+        const char *m_stage;
+        QElapsedTimer m_timer;
+    };
+
+
+    /**
+    * Measures how long a slot blocks the event loop; created at the beginning of the slot.
+    * The duration is added to the histogram of the slot, which also counts the calls over the budget
+    * (one frame at 60 Hz by default, see BIRTHDAYLIST_STALL_BUDGET in Applet::init). The stalls are logged
+    * at most once per m_warningIntervalMsecs for each slot, the next warning counts the stalls not logged meanwhile;
+    * the warning names the chain of the watched slots being executed, only the innermost stalled slot of the chain is reported.
+    */
+    class SlotWatchdog
+    {
+    public:
+        explicit SlotWatchdog(const char *slot);
+        ~SlotWatchdog();
+
+        /** Sets the budget of all slots in milliseconds */
+        static void setBudget(int msecs) { m_budgetUsecs = qint64(msecs) * 1000; }
+
+    private:
+        const char *m_slot;
+        QElapsedTimer m_timer;
+        /** Set by a nested slot that already reported the stall */
+        bool m_stallReported;
+
+        /** Rate limiting of the warnings of one slot */
+        struct StallWarnings {
+            StallWarnings() : lastWarningMsecs(-m_warningIntervalMsecs), unloggedStalls(0) {}
+            qint64 lastWarningMsecs;
+            int unloggedStalls;
+        };
+
+        static qint64 m_budgetUsecs;
+        static const qint64 m_warningIntervalMsecs = 60 * 1000;
+        static QElapsedTimer m_warningClock;
+        static QHash<const char*, StallWarnings> m_stallWarnings;
+        static QList<SlotWatchdog*> m_activeWatchdogs;
+    };
+};
+
+
+#endif //BIRTHDAYLIST_DIAGNOSTICS_H
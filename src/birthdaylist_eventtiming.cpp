@@ -0,0 +1,106 @@
+/**
+ * @file    birthdaylist_eventtiming.cpp
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_eventtiming.h"
+
+
+BirthdayList::AnnualEventTiming::AnnualEventTiming()
+{
+}
+
+void BirthdayList::AnnualEventTiming::reserve(int size)
+{
+    m_month.reserve(size);
+    m_day.reserve(size);
+    m_year.reserve(size);
+    m_dayOfYearBase.reserve(size);
+    m_afterFebruary.reserve(size);
+}
+
+void BirthdayList::AnnualEventTiming::clear()
+{
+    m_month.clear();
+    m_day.clear();
+    m_year.clear();
+    m_dayOfYearBase.clear();
+    m_afterFebruary.clear();
+    m_anniversaryYear.clear();
+    m_remainingDays.clear();
+    m_age.clear();
+}
+
+int BirthdayList::AnnualEventTiming::append(const QDate &date)
+{
+    int year, month, day;
+    date.getDate(&year, &month, &day);
+
+    m_month.append(month);
+    m_day.append(day);
+    m_year.append(year);
+
+    // day of the year = 275*month/9 - K*((month+9)/12) + day - 30, where K is 1 in leap years and 2 otherwise;
+    // everything except of K is precomputed here (February 29 gets the day number of March 1 in common years)
+    m_afterFebruary.append((month + 9) / 12);
+    m_dayOfYearBase.append((275 * month) / 9 - 2 * ((month + 9) / 12) + day - 30);
+
+    return m_month.size() - 1;
+}
+
+void BirthdayList::AnnualEventTiming::compute(const QDate &today, int pastThreshold)
+{
+    const int count = m_month.size();
+    m_anniversaryYear.resize(count);
+    m_remainingDays.resize(count);
+    m_age.resize(count);
+
+    const int curYear = today.year();
+    const int todayDayOfYear = today.dayOfYear();
+    const int leapPrev = QDate::isLeapYear(curYear - 1) ? 1 : 0;
+    const int leapCur = QDate::isLeapYear(curYear) ? 1 : 0;
+    const int leapNext = QDate::isLeapYear(curYear + 1) ? 1 : 0;
+    const int daysInPrevYear = 365 + leapPrev;
+    const int daysInCurYear = 365 + leapCur;
+
+    const int *year = m_year.constData();
+    const int *dayOfYearBase = m_dayOfYearBase.constData();
+    const int *afterFebruary = m_afterFebruary.constData();
+    int *anniversaryYear = m_anniversaryYear.data();
+    int *remainingDays = m_remainingDays.data();
+    int *age = m_age.data();
+
+    // no calls and no branches that can't be turned into selects, so that the loop can be vectorized
+    for (int i=0; i<count; ++i) {
+        const int daysToCur = dayOfYearBase[i] + leapCur * afterFebruary[i] - todayDayOfYear;
+        const int daysToNext = dayOfYearBase[i] + leapNext * afterFebruary[i] + daysInCurYear - todayDayOfYear;
+        const int daysToPrev = dayOfYearBase[i] + leapPrev * afterFebruary[i] - daysInPrevYear - todayDayOfYear;
+
+        const int useNext = (daysToCur < -pastThreshold) ? 1 : 0;
+        const int usePrev = (daysToCur > daysInCurYear - pastThreshold) ? 1 : 0;
+
+        remainingDays[i] = useNext ? daysToNext : (usePrev ? daysToPrev : daysToCur);
+        anniversaryYear[i] = curYear + useNext - usePrev;
+        age[i] = anniversaryYear[i] - year[i];
+    }
+}
+
+QDate BirthdayList::AnnualEventTiming::currentAnniversary(int index) const
+{
+    QDate anniversary(m_anniversaryYear[index], m_month[index], m_day[index]);
+    if (!anniversary.isValid()) anniversary = QDate(m_anniversaryYear[index], 3, 1);
+    return anniversary;
+}
@@ -0,0 +1,79 @@
+#ifndef BIRTHDAYLIST_EVENTTIMING_H
+#define BIRTHDAYLIST_EVENTTIMING_H
+
+/**
+ * @file    birthdaylist_eventtiming.h
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include <QDate>
+#include <QVector>
+
+
+namespace BirthdayList 
+{
+    /**
+    * Computes the current anniversaries, remaining days and ages of many annual events at once.
+    * The event dates are kept in separate integer arrays and the computation does not depend
+    * on QDate, so that the compiler can vectorize it.
+    * Events on February 29 are celebrated on March 1 in the common years.
+    */
+    class AnnualEventTiming {
+    public:
+        AnnualEventTiming();
+
+        void reserve(int size);
+        void clear();
+
+        /** Adds the date of an event, returns its index. */
+        int append(const QDate &date);
+
+        int size() const {
+            return m_month.size();
+        }
+
+        /** Computes the timing of all events relative to the given day. Anniversaries more than
+        *  pastThreshold days in the past are moved to the next year. */
+        void compute(const QDate &today, int pastThreshold);
+
+        int remainingDays(int index) const {
+            return m_remainingDays[index];
+        }
+
+        int age(int index) const {
+            return m_age[index];
+        }
+
+        /** Returns the date of the current anniversary of the event with the given index. */
+        QDate currentAnniversary(int index) const;
+
+    private:
+        QVector<int> m_month;
+        QVector<int> m_day;
+        QVector<int> m_year;
+        /** Day of the year in a common year, without the leap day correction */
+        QVector<int> m_dayOfYearBase;
+        /** 1 for the events after February (shifted by the leap day), 0 otherwise */
+        QVector<int> m_afterFebruary;
+
+        QVector<int> m_anniversaryYear;
+        QVector<int> m_remainingDays;
+        QVector<int> m_age;
+    };
+};
+
+
+#endif //BIRTHDAYLIST_EVENTTIMING_H
@@ -0,0 +1,73 @@
+/**
+ * @file    birthdaylist_memoryreport.cpp
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_memoryreport.h"
+#include "birthdaylist_diagnostics.h"
+#include <KDebug>
+
+
+void BirthdayList::MemoryReport::add(const QString &structure, qint64 bytes, qint64 objects)
+{
+    m_bytes[structure] += bytes;
+    m_objects[structure] += objects;
+}
+
+qint64 BirthdayList::MemoryReport::totalBytes() const
+{
+    qint64 total = 0;
+    foreach (qint64 bytes, m_bytes) total += bytes;
+    return total;
+}
+
+void BirthdayList::MemoryReport::publish() const
+{
+    Diagnostics *diagnostics = Diagnostics::instance();
+    QMapIterator<QString, qint64> bytesIt(m_bytes);
+    while (bytesIt.hasNext()) {
+        bytesIt.next();
+        diagnostics->setCounter("memory." + bytesIt.key(), bytesIt.value());
+        diagnostics->setCounter("memory." + bytesIt.key() + ".objects", m_objects.value(bytesIt.key()));
+    }
+    diagnostics->setCounter("memory.total", totalBytes());
+
+    kDebug() << "Estimated heap usage:" << totalBytes() << "bytes";
+}
+
+qint64 BirthdayList::MemoryReport::stringBytes(const QString &string)
+{
+    // QString::Data has a header of 24 bytes followed by the UTF-16 characters
+    if (string.capacity() == 0) return 0;
+    return allocationBytes(24 + 2 * (string.capacity() + 1));
+}
+
+qint64 BirthdayList::MemoryReport::stringListBytes(const QStringList &strings)
+{
+    qint64 bytes = listBytes(strings);
+    foreach (const QString &string, strings) bytes += stringBytes(string);
+    return bytes;
+}
+
+qint64 BirthdayList::MemoryReport::variantBytes(const QVariant &variant)
+{
+    switch (variant.type()) {
+    case QVariant::String: return stringBytes(variant.toString());
+    case QVariant::StringList: return stringListBytes(variant.toStringList());
+    case QVariant::ByteArray: return allocationBytes(24 + variant.toByteArray().capacity());
+    default: return 0;
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef BIRTHDAYLIST_MEMORYREPORT_H
+#define BIRTHDAYLIST_MEMORYREPORT_H
+
+/**
+ * @file    birthdaylist_memoryreport.h
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+
+namespace BirthdayList 
+{
+    /**
+    * Estimate of the heap used by the structures of the applet, computed from the sizes of the containers
+    * and approximate per-object costs of Qt 4 on 64-bit platforms (the implicitly shared data are counted
+    * by every structure referring to them, so the estimate is an upper bound).
+    */
+    class MemoryReport
+    {
+    public:
+        /** Adds the given number of bytes used by the given number of objects of the given structure */
+        void add(const QString &structure, qint64 bytes, qint64 objects = 1);
+
+        qint64 bytes(const QString &structure) const {
+            return m_bytes.value(structure);
+        }
+        qint64 objects(const QString &structure) const {
+            return m_objects.value(structure);
+        }
+        qint64 totalBytes() const;
+        QStringList structures() const {
+            return m_bytes.keys();
+        }
+
+        /** Stores the report in the counters of the diagnostics ("memory.<structure>" in bytes) */
+        void publish() const;
+
+        /** Returns the size of a heap block allocated for an object of the given size */
+        static qint64 allocationBytes(qint64 size) {
+            // glibc malloc adds one word and rounds to 16 bytes
+            return (size + 8 + 15) & ~qint64(15);
+        }
+        /** Returns the heap used by the string (nothing for the shared empty string) */
+        static qint64 stringBytes(const QString &string);
+        static qint64 stringListBytes(const QStringList &strings);
+        static qint64 variantBytes(const QVariant &variant);
+
+        /** Returns the heap used by the buckets and nodes of the hash (without the heap of the keys and values) */
+        template<typename Key, typename T>
+        static qint64 hashBytes(const QHash<Key, T> &hash) {
+            if (hash.capacity() == 0) return 0;
+            return allocationBytes(hash.capacity() * sizeof(void*)) +
+                hash.size() * allocationBytes(2 * sizeof(void*) + sizeof(Key) + sizeof(T));
+        }
+        /** Returns the heap used by the array and nodes of the list (without the heap of the items) */
+        template<typename T>
+        static qint64 listBytes(const QList<T> &list) {
+            if (list.isEmpty()) return 0;
+            qint64 bytes = allocationBytes(list.size() * sizeof(void*) + 16);
+            if (QTypeInfo<T>::isLarge || QTypeInfo<T>::isStatic) bytes += list.size() * allocationBytes(sizeof(T));
+            return bytes;
+        }
+
+    private:
+        QMap<QString, qint64> m_bytes;
+        QMap<QString, qint64> m_objects;
+    };
+};
+
+
+#endif //BIRTHDAYLIST_MEMORYREPORT_H
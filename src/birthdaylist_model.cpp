@@ -17,14 +17,20 @@
 
 
 #include "birthdaylist_model.h"
+#include "birthdaylist_clock.h"
+#include "birthdaylist_diagnostics.h"
+#include "birthdaylist_memoryreport.h"
 #include "birthdaylist_modelentry.h"
+#include "birthdaylist_sharedsources.h"
 #include "birthdaylist_source_akonadi.h"
 #include "birthdaylist_source_collections.h"
 #include "birthdaylist_source_kabc.h"
+#include "birthdaylist_trace.h"
 #include <KDebug>
 #include <KLocalizedString>
 #include <QDateTime>
 #include <QFile>
+#include <QVector>
 
 
 BirthdayList::ModelConfiguration::ModelConfiguration() :
@@ -54,10 +60,20 @@ pastColorSettings(false, QColor(0, 0, 0), true, QColor(160, 0, 0), true)
 }
 
 
-BirthdayList::Model::Model() 
+BirthdayList::Model::Model(Source_Collections *sourceCollections) 
 : QStandardItemModel(0, 5),
-m_source_collections(new Source_Collections()),
-m_source_contacts(0)
+m_source_collections(sourceCollections),
+m_source_contacts(0),
+m_sharedCollections(false),
+m_sharedContactSource(false),
+m_sourcesHeld(false),
+m_contactSourcePending(false),
+m_suspended(false),
+m_modelUpdatePending(false),
+m_clock(Clock::systemClock()),
+m_loadedEntries(0),
+m_sortColumn(3),
+m_sortOrder(Qt::AscendingOrder)
 {
     QStringList headerTitles;
     headerTitles << i18n("Name") << i18n("Age") << i18n("Date") << i18n("When") << "" << "";
@@ -65,12 +81,10 @@ m_source_contacts(0)
 
     // configure the timer that will update the model at the next midnight (update entries, timing of events, etc.)
     m_midnightTimer.setSingleShot(true);
-    QDateTime nextMidnight = QDateTime(QDate::currentDate()).addDays(1);
-    int msecToNextMidnight = 1000 * (1 + QDateTime::currentDateTime().secsTo(nextMidnight));
-    m_midnightTimer.setInterval(msecToNextMidnight);
-
     connect(&m_midnightTimer, SIGNAL(timeout()), this, SLOT(midnightUpdate()));
-    m_midnightTimer.start();
+    scheduleMidnightUpdate();
+
+    Diagnostics::instance()->recordMilestone("modelConstructed");
 
     // do the initial update (although the data might not have been read yet)
     updateModel();
@@ -79,9 +93,15 @@ m_source_contacts(0)
 BirthdayList::Model::~Model() 
 {
     disconnect(&m_midnightTimer, SIGNAL(timeout()), this, SLOT(midnightUpdate()));
+
+    // make sure that no model rows refer to the deleted entries
+    setRowCount(0);
+    deleteEventEntries();
+    deleteCalendarTemplate();
     
-    delete m_source_contacts;
-    delete m_source_collections;
+    replaceContactSource(0, false);
+    if (m_sharedCollections) SharedSources::instance()->releaseCollections(m_source_collections);
+    else delete m_source_collections;
 }
 
 void BirthdayList::Model::setConfiguration(ModelConfiguration newConf) 
@@ -96,47 +116,15 @@ void BirthdayList::Model::setConfiguration(ModelConfiguration newConf)
 
     if (oldNamedayFile != newConf.curNamedayFile) {
         // read the nameday definitions from the currently selected file
-        m_curLangNamedayList.clear();
-        
-        QFile namedayFile(newConf.curNamedayFile);
-        if (namedayFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QTextStream stream(&namedayFile);
-            int readEntries = 0, skippedEntries = 0;
-            // skip language string
-            stream.readLine();
-            while (!stream.atEnd()) {
-                QString namedayEntry = stream.readLine();
-                int dateIndex = namedayEntry.indexOf(QRegExp("[0-9][0-9]-[0-9][0-9]"), 0);
-                if (dateIndex >= 0) {
-                    m_curLangNamedayList.insert(namedayEntry.mid(dateIndex, 5), namedayEntry.mid(dateIndex + 5).trimmed());
-                    ++readEntries;
-                }
-                else ++skippedEntries;
-            }
-            namedayFile.close();
-            kDebug() << "Read" << readEntries << "and skipped" << skippedEntries << "nameday entries from" << newConf.curNamedayFile;
-        }
-        else {
-            kDebug() << "Cannot open nameday file" << newConf.curNamedayFile;
-        }
+        loadNamedayCalendar(newConf.curNamedayFile);
     }
 
     // update contact source
     if (newConf.eventDataSource == ModelConfiguration::EDS_Akonadi) {
         // don't re-register to the same collection if it has not been changed
         if (oldEventDataSource != newConf.eventDataSource || oldAkonadiCollectionId != newConf.akonadiCollectionId) {
-            kDebug() << "Going to read contact event data from Akonadi collection Id" << newConf.akonadiCollectionId;
-            
-            if (m_source_contacts) {
-                disconnect(m_source_contacts, SIGNAL(contactsUpdated()), this, SLOT(contactCollectionUpdated()));
-                delete m_source_contacts;
-            }
-
-            Source_Akonadi *source_contacts_akonadi = new Source_Akonadi(*m_source_collections);
-            source_contacts_akonadi->setCurrentCollection(newConf.akonadiCollectionId);
-
-            m_source_contacts = source_contacts_akonadi;
-            connect(m_source_contacts, SIGNAL(contactsUpdated()), this, SLOT(contactCollectionUpdated()));
+            if (m_sourcesHeld) m_contactSourcePending = true;
+            else registerAkonadiSource();
         }
     }
 /*    else {
@@ -161,168 +149,489 @@ BirthdayList::ModelConfiguration BirthdayList::Model::getConfiguration() const
 
 QHash<QString, int> BirthdayList::Model::getAkonadiCollections()
 {
-    return m_source_collections->getAkonadiCollections();
+    return sourceCollections().getAkonadiCollections();
 }
 
-void BirthdayList::Model::refreshContactEvents() 
+void BirthdayList::Model::holdSources()
 {
-    // since we are going to re-create all entries again, delete currently existing ones
-    kDebug() << "Reading contact sources to create a new BirthdayList Model";
+    m_sourcesHeld = true;
+}
 
-    foreach(AbstractAnnualEventEntry *oldListEntry, m_listEntries) {
-        delete oldListEntry;
+void BirthdayList::Model::startSources()
+{
+    if (!m_sourcesHeld) return;
+    BL_TRACE_SPAN(TC_Model, "startSources");
+    m_sourcesHeld = false;
+    Diagnostics::instance()->recordMilestone("sourcesStarted");
+
+    if (m_contactSourcePending) {
+        m_contactSourcePending = false;
+        registerAkonadiSource();
+        refreshContactEvents();
     }
-    m_listEntries.clear();
+}
+
+void BirthdayList::Model::setSuspended(bool suspended)
+{
+    if (m_suspended == suspended) return;
+    BL_TRACE_SPAN(TC_Model, suspended ? "suspend" : "resume");
+    m_suspended = suspended;
+
+    // resuming the source refreshes the events if the contacts changed meanwhile, which also rebuilds the rows
+    if (m_sharedContactSource) SharedSources::instance()->setClientSuspended(m_source_contacts, this, suspended);
+    else if (m_source_contacts) m_source_contacts->setSuspended(suspended);
+    if (!suspended && m_modelUpdatePending) {
+        updateModel();
+        emit eventsUpdated();
+    }
+}
+
+BirthdayList::Source_Collections &BirthdayList::Model::sourceCollections()
+{
+    if (!m_source_collections) {
+        m_source_collections = SharedSources::instance()->acquireCollections();
+        m_sharedCollections = true;
+    }
+    return *m_source_collections;
+}
+
+void BirthdayList::Model::registerAkonadiSource()
+{
+    kDebug() << "Going to read contact event data from Akonadi collection Id" << m_conf.akonadiCollectionId;
+
+    // a collection source given to the constructor (e.g. by AkonadiStandIn) gets a private contact source
+    if (m_source_collections && !m_sharedCollections) {
+        Source_Akonadi *source_contacts_akonadi = new Source_Akonadi(*m_source_collections);
+        source_contacts_akonadi->setCurrentCollection(m_conf.akonadiCollectionId);
+        replaceContactSource(source_contacts_akonadi, false);
+    }
+    else replaceContactSource(SharedSources::instance()->acquireAkonadiSource(m_conf.akonadiCollectionId, this), true);
+}
+
+void BirthdayList::Model::setContactSource(Source_Contacts *source)
+{
+    replaceContactSource(source, false);
+}
+
+void BirthdayList::Model::replaceContactSource(Source_Contacts *source, bool shared)
+{
+    if (m_source_contacts) {
+        disconnect(m_source_contacts, SIGNAL(contactsUpdated()), this, SLOT(contactCollectionUpdated()));
+        if (m_sharedContactSource) SharedSources::instance()->releaseAkonadiSource(static_cast<Source_Akonadi*>(m_source_contacts), this);
+        else delete m_source_contacts;
+    }
+
+    m_source_contacts = source;
+    m_sharedContactSource = shared;
+    if (m_source_contacts) {
+        if (shared) SharedSources::instance()->setClientSuspended(m_source_contacts, this, m_suspended);
+        else m_source_contacts->setSuspended(m_suspended);
+        connect(m_source_contacts, SIGNAL(contactsUpdated()), this, SLOT(contactCollectionUpdated()));
+    }
+}
+
+void BirthdayList::Model::loadNamedayCalendar(const QString &fileName)
+{
+    m_curLangNamedayList.clear();
+
+    QFile namedayFile(fileName);
+    if (namedayFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QTextStream stream(&namedayFile);
+        int readEntries = 0, skippedEntries = 0;
+        // skip language string
+        stream.readLine();
+        while (!stream.atEnd()) {
+            QString namedayEntry = stream.readLine();
+            int dateIndex = namedayEntry.indexOf(QRegExp("[0-9][0-9]-[0-9][0-9]"), 0);
+            if (dateIndex >= 0) {
+                m_curLangNamedayList.insert(namedayEntry.mid(dateIndex, 5), namedayEntry.mid(dateIndex + 5).trimmed());
+                ++readEntries;
+            }
+            else ++skippedEntries;
+        }
+        namedayFile.close();
+        kDebug() << "Read" << readEntries << "and skipped" << skippedEntries << "nameday entries from" << fileName;
+    }
+    else {
+        kDebug() << "Cannot open nameday file" << fileName;
+    }
+}
+
+void BirthdayList::Model::refreshContactEvents() 
+{
+    // since we are going to re-create all entries again, delete currently existing ones
+    BL_TRACE_SPAN(TC_Model, "refreshContactEvents");
+    DiagnosticsTimer refreshTimer("refresh");
+    deleteEventEntries();
 
     // store nameday entries separately (so that they can be aggregated)
     QList<NamedayEntry *> namedayEntries;
+    const QDate today = m_clock->currentDate();
 
-    // iterate over the contacts from the contacts source and create appropriate list entries
+    // process the contacts from the contact source stage by stage and create appropriate list entries
     if (m_source_contacts != 0) {
         const QHash<QString, AddresseeInfo> contacts = m_source_contacts->getAllContacts();
-        kDebug() << "Source contains" << contacts.size() << "contacts";
-        QHashIterator<QString, AddresseeInfo> contactIt(contacts);
-        while (contactIt.hasNext()) {
-            AddresseeInfo contactInfo = contactIt.next().value();
-
-            QString contactName = contactInfo.name;
-            QString contactNickname = contactInfo.nickName;
-            if (m_conf.showNicknames && !contactNickname.isEmpty()) contactName = contactNickname;
-            QDate contactBirthday = contactInfo.birthday;
-            QDate contactNameday;
-            // first try to get the nameday by the selected fate field
-            if (m_conf.namedayByAnniversaryDateField) {
-                contactNameday = getContactDateField(contactInfo, "X-Anniversary");
-            }
-            else if (m_conf.namedayByCustomDateField) {
-                contactNameday = getContactDateField(contactInfo, m_conf.namedayCustomDateFieldName);
-            }
-            // if none of the date fields were allowed or the nameday could not be found, try to determine it by the contact's given nameday
-            if (!contactNameday.isValid() && m_conf.namedayByGivenName) {
-                contactNameday = getNamedayByGivenName(contactInfo.givenName);
-            }
+        BL_TRACE_COUNTER(TC_Model, "contacts", contacts.size());
+        Diagnostics::instance()->setCounter("contacts", contacts.size());
 
-            QDate contactAnniversary = getContactDateField(contactInfo, "X-Anniversary");
-            QString contactEmail = contactInfo.email;
-            QString contactUrl = contactInfo.homepage;
-            
-            if (m_conf.filterType == ModelConfiguration::FT_Off) {
-                // do nothing; this check comes first as it is the most likely selected option
-            } else if (m_conf.filterType == ModelConfiguration::FT_Category) {
-                if (!contactInfo.categories.contains(m_conf.filterValue)) continue;
-            } else if (m_conf.filterType == ModelConfiguration::FT_CustomField) {
-                if (contactInfo.customFields[QString("Custom_%1").arg(m_conf.customFieldName)] != m_conf.filterValue) continue;
-            } else if (m_conf.filterType == ModelConfiguration::FT_CustomFieldPrefix) {
-                bool filterValueFound = false;
-                QString customFieldNamePattern = QString("Custom_%1").arg(m_conf.customFieldPrefix);
-                
-                QStringList contactFields = contactInfo.customFields.keys();
-                foreach (QString field, contactFields) {
-                    if (field.startsWith(customFieldNamePattern) && contactInfo.customFields[field] == m_conf.filterValue) {
-                        filterValueFound = true;
-                        break;
-                    }
-                }
-                
-                if (!filterValueFound) continue;
-            }
-            
-            if (contactBirthday.isValid()) {
-                m_listEntries.append(new BirthdayEntry(contactName, contactBirthday, contactEmail, contactUrl));
-            }
-            if (m_conf.showNamedays && contactNameday.isValid()) {
-                QDate firstNameday = contactNameday;
-                if (contactBirthday.isValid()) {
-                    firstNameday.setDate(contactBirthday.year(), contactNameday.month(), contactNameday.day());
-                    if (firstNameday < contactBirthday) firstNameday = firstNameday.addYears(1);
-                }
-                namedayEntries.append(new NamedayEntry(contactName, firstNameday, contactEmail, contactUrl));
-            }
-            if (m_conf.showAnniversaries && contactAnniversary.isValid()) {
-                m_listEntries.append(new AnniversaryEntry(contactName, contactAnniversary, contactEmail, contactUrl));
+        DiagnosticsTimer filterTimer("filter");
+        QList<const AddresseeInfo*> acceptedContacts;
+        for (QHash<QString, AddresseeInfo>::const_iterator contactIt = contacts.constBegin(); contactIt != contacts.constEnd(); ++contactIt) {
+            if (isContactAccepted(contactIt.value())) acceptedContacts.append(&contactIt.value());
+        }
+        filterTimer.stop();
+        Diagnostics::instance()->setCounter("acceptedContacts", acceptedContacts.size());
+
+        QVector<QDate> contactNamedays(acceptedContacts.size());
+        if (m_conf.showNamedays) {
+            DiagnosticsTimer namedayTimer("namedayResolution");
+            for (int i=0; i<acceptedContacts.size(); ++i) {
+                contactNamedays[i] = getContactNameday(*acceptedContacts[i]);
             }
         }
 
-        // if desired, join together nameday entries from the same day
-        if (m_conf.namedayDisplayMode == ModelConfiguration::NDM_AggregateEvents || 
-            m_conf.namedayDisplayMode == ModelConfiguration::NDM_AllCalendarNames) {
-            qSort(namedayEntries.begin(), namedayEntries.end(), AbstractAnnualEventEntry::lessThan);
-            int curYear = QDate::currentDate().year();
-            QMap<QDate, AggregatedNamedayEntry*> aggregatedEntries;
+        DiagnosticsTimer entryTimer("entryCreation");
+        for (int i=0; i<acceptedContacts.size(); ++i) {
+            createContactEntries(*acceptedContacts[i], contactNamedays[i], namedayEntries);
+        }
+        entryTimer.stop();
 
-            // if all calendar names are to be shown, prepare entries for the visualised period
-            if (m_conf.namedayDisplayMode == ModelConfiguration::NDM_AllCalendarNames) {
-                QDate initialDate = QDate::currentDate().addDays(-m_conf.pastThreshold);
-                QDate finalDate = initialDate.addYears(1);
+        // compute the timing of all entries at once
+        DiagnosticsTimer timingTimer("eventTiming");
+        QList<AbstractAnnualEventEntry*> timedEntries = m_listEntries;
+        foreach(NamedayEntry *namedayEntry, namedayEntries) {
+            timedEntries.append(namedayEntry);
+        }
+        AbstractAnnualEventEntry::updateTiming(timedEntries, today, m_conf.pastThreshold);
+        timingTimer.stop();
 
-                for (QDate date=initialDate; date<finalDate; date = date.addDays(1)) {
-                    aggregatedEntries[date] = new AggregatedNamedayEntry(getNamedayString(date), date);
-                }
+        DiagnosticsTimer aggregationTimer("aggregation");
+        aggregateNamedayEntries(namedayEntries, today);
+    }
+
+    // sort the entries by date
+    DiagnosticsTimer sortTimer("sort");
+    AbstractAnnualEventEntry::sortEntries(m_listEntries);
+    sortTimer.stop();
+    Diagnostics::instance()->setCounter("events", m_listEntries.size());
+
+    BL_TRACE_COUNTER(TC_Model, "events", m_listEntries.size());
+
+    if (m_suspended) m_modelUpdatePending = true;
+    else updateModel();
+
+    emit eventsUpdated();
+}
+
+bool BirthdayList::Model::isContactAccepted(const AddresseeInfo &contactInfo) const
+{
+    if (m_conf.filterType == ModelConfiguration::FT_Off) {
+        // do nothing; this check comes first as it is the most likely selected option
+    } else if (m_conf.filterType == ModelConfiguration::FT_Category) {
+        if (!contactInfo.categories.contains(m_conf.filterValue)) return false;
+    } else if (m_conf.filterType == ModelConfiguration::FT_CustomField) {
+        if (contactInfo.customFields.value(QString("Custom_%1").arg(m_conf.customFieldName)) != m_conf.filterValue) return false;
+    } else if (m_conf.filterType == ModelConfiguration::FT_CustomFieldPrefix) {
+        bool filterValueFound = false;
+        QString customFieldNamePattern = QString("Custom_%1").arg(m_conf.customFieldPrefix);
+        
+        QHashIterator<QString, QVariant> fieldIt(contactInfo.customFields);
+        while (fieldIt.hasNext()) {
+            fieldIt.next();
+            if (fieldIt.key().startsWith(customFieldNamePattern) && fieldIt.value() == m_conf.filterValue) {
+                filterValueFound = true;
+                break;
             }
+        }
+        
+        if (!filterValueFound) return false;
+    }
 
-            foreach(NamedayEntry *namedayEntry, namedayEntries) {
-                const QDate namedayDate = namedayEntry->date();
-                QDate curYearDate(curYear, namedayDate.month(), namedayDate.day());
+    return true;
+}
+
+QDate BirthdayList::Model::getContactNameday(const AddresseeInfo &contactInfo)
+{
+    QDate contactNameday;
+    // first try to get the nameday by the selected fate field
+    if (m_conf.namedayByAnniversaryDateField) {
+        contactNameday = getContactDateField(contactInfo, "X-Anniversary");
+    }
+    else if (m_conf.namedayByCustomDateField) {
+        contactNameday = getContactDateField(contactInfo, m_conf.namedayCustomDateFieldName);
+    }
+    // if none of the date fields were allowed or the nameday could not be found, try to determine it by the contact's given nameday
+    if (!contactNameday.isValid() && m_conf.namedayByGivenName) {
+        contactNameday = getNamedayByGivenName(contactInfo.givenName);
+    }
 
-                AggregatedNamedayEntry *aggregatedEntry = 0;
+    return contactNameday;
+}
+
+void BirthdayList::Model::createContactEntries(const AddresseeInfo &contactInfo, const QDate &contactNameday, QList<NamedayEntry*> &namedayEntries)
+{
+    QString contactName = contactInfo.name;
+    QString contactNickname = contactInfo.nickName;
+    if (m_conf.showNicknames && !contactNickname.isEmpty()) contactName = contactNickname;
+    QDate contactBirthday = contactInfo.birthday;
+    QDate contactAnniversary = getContactDateField(contactInfo, "X-Anniversary");
+    QString contactEmail = contactInfo.email;
+    QString contactUrl = contactInfo.homepage;
+
+    if (contactBirthday.isValid()) {
+        m_listEntries.append(new BirthdayEntry(contactName, contactBirthday, contactEmail, contactUrl));
+    }
+    if (m_conf.showNamedays && contactNameday.isValid()) {
+        QDate firstNameday = contactNameday;
+        if (contactBirthday.isValid()) {
+            firstNameday.setDate(contactBirthday.year(), contactNameday.month(), contactNameday.day());
+            if (firstNameday < contactBirthday) firstNameday = firstNameday.addYears(1);
+        }
+        namedayEntries.append(new NamedayEntry(contactName, firstNameday, contactEmail, contactUrl));
+    }
+    if (m_conf.showAnniversaries && contactAnniversary.isValid()) {
+        m_listEntries.append(new AnniversaryEntry(contactName, contactAnniversary, contactEmail, contactUrl));
+    }
+}
+
+void BirthdayList::Model::aggregateNamedayEntries(QList<NamedayEntry*> &namedayEntries, const QDate &today)
+{
+    // if desired, join together nameday entries from the same day
+    if (m_conf.namedayDisplayMode == ModelConfiguration::NDM_AggregateEvents || 
+        m_conf.namedayDisplayMode == ModelConfiguration::NDM_AllCalendarNames) {
+        qSort(namedayEntries.begin(), namedayEntries.end(), AbstractAnnualEventEntry::lessThan);
+        int curYear = today.year();
+        QMap<QDate, AggregatedNamedayEntry*> aggregatedEntries;
+
+        // if all calendar names are to be shown, reuse the prepared entries for the visualised period
+        bool useCalendarTemplate = (m_conf.namedayDisplayMode == ModelConfiguration::NDM_AllCalendarNames);
+        if (useCalendarTemplate) updateCalendarTemplate();
+
+        foreach(NamedayEntry *namedayEntry, namedayEntries) {
+            const QDate namedayDate = namedayEntry->date();
+
+            AggregatedNamedayEntry *aggregatedEntry = 0;
+            if (useCalendarTemplate) aggregatedEntry = m_calendarTemplateDays.value(calendarDayKey(namedayDate));
+
+            if (!aggregatedEntry) {
+                QDate curYearDate(curYear, namedayDate.month(), namedayDate.day());
+                // namedays on February 29 are celebrated on March 1 in the common years (see AnnualEventTiming)
+                if (!curYearDate.isValid()) curYearDate = QDate(curYear, 3, 1);
                 if (aggregatedEntries.contains(curYearDate))
                     aggregatedEntry = aggregatedEntries[curYearDate];
                 else {
                     aggregatedEntry = new AggregatedNamedayEntry(getNamedayString(curYearDate), curYearDate);
                     aggregatedEntries[curYearDate] = aggregatedEntry;
                 }
-                aggregatedEntry->addNamedayEntry(namedayEntry);
             }
+            aggregatedEntry->addNamedayEntry(namedayEntry);
+        }
 
-            foreach(AggregatedNamedayEntry *entry, aggregatedEntries) {
+        if (useCalendarTemplate) {
+            foreach(AggregatedNamedayEntry *entry, m_calendarTemplate) {
                 m_listEntries.append(entry);
             }
-        } else if (m_conf.namedayDisplayMode == ModelConfiguration::NDM_IndividualEvents) {
+        }
+        QList<AbstractAnnualEventEntry*> newAggregatedEntries;
+        foreach(AggregatedNamedayEntry *entry, aggregatedEntries) {
+            newAggregatedEntries.append(entry);
+            m_listEntries.append(entry);
+        }
+        AbstractAnnualEventEntry::updateTiming(newAggregatedEntries, today, m_conf.pastThreshold);
+    } else if (m_conf.namedayDisplayMode == ModelConfiguration::NDM_IndividualEvents) {
 
-            foreach(NamedayEntry *entry, namedayEntries) {
-                m_listEntries.append(entry);
-            }
+        foreach(NamedayEntry *entry, namedayEntries) {
+            m_listEntries.append(entry);
         }
     }
+}
 
-    // sort the entries by date
-    qSort(m_listEntries.begin(), m_listEntries.end(), AbstractAnnualEventEntry::lessThan);
+void BirthdayList::Model::deleteEventEntries()
+{
+    // forget also the rows not created yet, they point to the deleted entries
+    m_visibleEntries.clear();
+    m_unpopulatedItems.clear();
+    m_loadedEntries = 0;
 
-    kDebug() << "" << m_listEntries.size() << "event entries read from the contact source";
+    foreach(AbstractAnnualEventEntry *oldListEntry, m_listEntries) {
+        // the entries of the calendar template are kept for the next refresh, only their contacts are removed
+        AggregatedNamedayEntry *templateEntry = m_calendarTemplateDays.value(calendarDayKey(oldListEntry->date()));
+        if (templateEntry == oldListEntry) templateEntry->clearNamedayEntries();
+        else delete oldListEntry;
+    }
+    m_listEntries.clear();
+}
 
-    updateModel();
+void BirthdayList::Model::updateCalendarTemplate()
+{
+    QDate initialDate = m_clock->currentDate().addDays(-m_conf.pastThreshold);
+    QString templateKey = QString("%1|%2|%3").arg(m_conf.curNamedayFile).arg(m_conf.dateFormat).arg(initialDate.toString(Qt::ISODate));
+    if (templateKey == m_calendarTemplateKey) return;
+
+    kDebug() << "Preparing nameday calendar entries from" << initialDate;
+    deleteCalendarTemplate();
+
+    QDate finalDate = initialDate.addYears(1);
+    QList<AbstractAnnualEventEntry*> calendarEntries;
+    for (QDate date=initialDate; date<finalDate; date = date.addDays(1)) {
+        AggregatedNamedayEntry *calendarEntry = new AggregatedNamedayEntry(getNamedayString(date), date);
+        m_calendarTemplate.append(calendarEntry);
+        m_calendarTemplateDays.insert(calendarDayKey(date), calendarEntry);
+        calendarEntries.append(calendarEntry);
+    }
+
+    AbstractAnnualEventEntry::updateTiming(calendarEntries, m_clock->currentDate(), m_conf.pastThreshold);
+    foreach(AggregatedNamedayEntry *calendarEntry, m_calendarTemplate) {
+        calendarEntry->cacheDisplayStrings(m_conf.dateFormat);
+    }
+
+    m_calendarTemplateKey = templateKey;
 }
 
+void BirthdayList::Model::deleteCalendarTemplate()
+{
+    // the template entries must not be referenced by the event list anymore
+    QList<AbstractAnnualEventEntry*>::iterator entryIt = m_listEntries.begin();
+    while (entryIt != m_listEntries.end()) {
+        if (m_calendarTemplateDays.value(calendarDayKey((*entryIt)->date())) == *entryIt) entryIt = m_listEntries.erase(entryIt);
+        else ++entryIt;
+    }
+
+    foreach(AggregatedNamedayEntry *calendarEntry, m_calendarTemplate) {
+        delete calendarEntry;
+    }
+    m_calendarTemplate.clear();
+    m_calendarTemplateDays.clear();
+    m_calendarTemplateKey.clear();
+}
 
 void BirthdayList::Model::updateModel() 
 {
-    kDebug() << "Creating new BirthdayList model";
+    BL_TRACE_SPAN(TC_Model, "updateModel");
+    DiagnosticsTimer modelBuildTimer("modelBuild");
 
     setRowCount(0);
-    QStandardItem *parentItem = invisibleRootItem();
+    m_visibleEntries.clear();
+    m_unpopulatedItems.clear();
+    m_loadedEntries = 0;
+    m_modelUpdatePending = false;
 
     foreach (const AbstractAnnualEventEntry *entry, m_listEntries) {
         int remainingDays = entry->remainingDays();
         bool showEvent = (remainingDays >= 0 && remainingDays <= m_conf.eventThreshold) ||
                 (remainingDays <= 0 && remainingDays >= -m_conf.pastThreshold);
 
-        if (showEvent) {
-            QList<QStandardItem*> items;
-            entry->createModelItems(items, m_conf.dateFormat);
-            for (int i=0; i<items.size(); ++i) setModelItemStyle(entry, items[i], i);
+        if (showEvent) m_visibleEntries.append(entry);
+    }
+    // the event list is sorted by time, reorder the visible entries if the user selected another order
+    sortVisibleEntries();
+
+    // only the first page is created now, the rest is added when the view scrolls down (see fetchMore)
+    appendEntryRows(m_rowPageSize);
+
+    BL_TRACE_COUNTER(TC_Model, "visibleEvents", m_visibleEntries.size());
+    Diagnostics::instance()->setCounter("visibleEvents", m_visibleEntries.size());
+
+    if (rowCount() > 0 && Diagnostics::instance()->recordMilestone("firstPopulatedRow")) {
+        kDebug() << "Startup milestones:" << Diagnostics::instance()->milestoneSummary();
+    }
+}
+
+void BirthdayList::Model::appendEntryRows(int rowCount)
+{
+    QStandardItem *parentItem = invisibleRootItem();
+
+    int lastEntry = qMin(m_loadedEntries + rowCount, m_visibleEntries.size());
+    for (; m_loadedEntries < lastEntry; ++m_loadedEntries) {
+        const AbstractAnnualEventEntry *entry = m_visibleEntries[m_loadedEntries];
+
+        QList<QStandardItem*> items;
+        entry->createModelItems(items, m_conf.dateFormat);
+        for (int i=0; i<items.size(); ++i) setModelItemStyle(entry, items[i], i);
+        items[0]->setData(QString("%1 %2").arg(entry->date().toString(Qt::ISODate)).arg(entry->name()), EventKeyRole);
+        if (entry->childCount() > 0) m_unpopulatedItems.insert(items[0], entry);
+
+        parentItem->appendRow(items);
+    }
+}
 
-            parentItem->appendRow(items);
+void BirthdayList::Model::populateEntryChildren(QStandardItem *item)
+{
+    const AbstractAnnualEventEntry *entry = m_unpopulatedItems.take(item);
+    if (!entry) return;
+
+    entry->createChildModelItems(item, m_conf.dateFormat);
+    for (int row = 0; row < item->rowCount(); ++row) {
+        for (int col = 0; col < item->columnCount(); ++col) {
+            QStandardItem *child = item->child(row, col);
+            if (child) setModelItemStyle(entry, child, col);
         }
     }
+}
+
+void BirthdayList::Model::sort(int column, Qt::SortOrder order)
+{
+    m_sortColumn = column;
+    m_sortOrder = order;
+    
+    sortVisibleEntries();
+
+    // recreate the rows in the new order, starting with the first page again
+    setRowCount(0);
+    m_unpopulatedItems.clear();
+    m_loadedEntries = 0;
+    appendEntryRows(m_rowPageSize);
+}
+
+void BirthdayList::Model::sortVisibleEntries()
+{
+    if (m_sortColumn == 0) qStableSort(m_visibleEntries.begin(), m_visibleEntries.end(), nameLessThan);
+    else if (m_sortColumn == 1) qStableSort(m_visibleEntries.begin(), m_visibleEntries.end(), ageLessThan);
+    // the visible entries are sorted by time already (date and remaining days give the same order)
+
+    if (m_sortOrder == Qt::DescendingOrder) {
+        for (int i=0, j=m_visibleEntries.size()-1; i<j; ++i, --j) m_visibleEntries.swap(i, j);
+    }
+}
+
+bool BirthdayList::Model::nameLessThan(const AbstractAnnualEventEntry *a, const AbstractAnnualEventEntry *b)
+{
+    if (a->nameCollationKey() != b->nameCollationKey()) return a->nameCollationKey() < b->nameCollationKey();
+    else return AbstractAnnualEventEntry::lessThan(a, b);
+}
+
+bool BirthdayList::Model::ageLessThan(const AbstractAnnualEventEntry *a, const AbstractAnnualEventEntry *b)
+{
+    if (a->age() != b->age()) return a->age() < b->age();
+    else return AbstractAnnualEventEntry::lessThan(a, b);
+}
+
+bool BirthdayList::Model::canFetchMore(const QModelIndex &parent) const
+{
+    if (!parent.isValid()) return m_loadedEntries < m_visibleEntries.size();
+    else if (m_unpopulatedItems.contains(itemFromIndex(parent))) return true;
+    else return QStandardItemModel::canFetchMore(parent);
+}
+
+void BirthdayList::Model::fetchMore(const QModelIndex &parent)
+{
+    if (!parent.isValid()) appendEntryRows(m_rowPageSize);
+    else if (m_unpopulatedItems.contains(itemFromIndex(parent))) populateEntryChildren(itemFromIndex(parent));
+    else QStandardItemModel::fetchMore(parent);
+}
 
-    kDebug() << "New BirthdayList model contains" << rowCount() << "items";
+bool BirthdayList::Model::hasChildren(const QModelIndex &parent) const
+{
+    // answer from the number of stored entries, the child rows may not have been created yet
+    if (parent.isValid() && m_unpopulatedItems.contains(itemFromIndex(parent))) return true;
+    else return QStandardItemModel::hasChildren(parent);
 }
 
 QDate BirthdayList::Model::getNamedayByGivenName(QString givenName) 
 {
     if (givenName.isEmpty()) return QDate();
 
-    QDate initialDate = QDate::currentDate().addDays(-m_conf.pastThreshold);
+    QDate initialDate = m_clock->currentDate().addDays(-m_conf.pastThreshold);
     QDate finalDate = initialDate.addYears(1);
     for (QDate date=initialDate; date<finalDate; date = date.addDays(1)) {
         QStringList calendarNames = getNamedayString(date).split(QRegExp("\\W+"), QString::SkipEmptyParts);
@@ -394,18 +703,158 @@ void BirthdayList::Model::setModelItemStyle(const AbstractAnnualEventEntry *entr
 
 void BirthdayList::Model::contactCollectionUpdated()
 {
-    kDebug() << "Selected contact collection updated, triggering BirthdayList model refresh";
+    SlotWatchdog watchdog("Model::contactCollectionUpdated");
+    BL_TRACE_EVENT(TC_Model, "contactCollectionUpdated", QString());
+    Diagnostics::instance()->recordMilestone("firstContactsUpdated");
     refreshContactEvents();
 }
 
 
 void BirthdayList::Model::midnightUpdate()
 {
+    SlotWatchdog watchdog("Model::midnightUpdate");
     kDebug() << "Performing midnight update";
+    performDayRollover();
+}
+
+void BirthdayList::Model::setClock(Clock *clock)
+{
+    m_clock = clock;
+}
+
+void BirthdayList::Model::performDayRollover()
+{
     refreshContactEvents();
+    scheduleMidnightUpdate();
+}
 
-    QDateTime nextMidnight = QDateTime(QDate::currentDate()).addDays(1);
-    int msecToNextMidnight = 1000 * (1 + QDateTime::currentDateTime().secsTo(nextMidnight));
+void BirthdayList::Model::scheduleMidnightUpdate()
+{
+    QDateTime nextMidnight = QDateTime(m_clock->currentDate()).addDays(1);
+    int msecToNextMidnight = 1000 * (1 + m_clock->currentDateTime().secsTo(nextMidnight));
     m_midnightTimer.setInterval(msecToNextMidnight);
     m_midnightTimer.start();
 }
+
+int BirthdayList::Model::firstUpcomingEntry() const
+{
+    // the event list is sorted by the remaining days, the past events are at its beginning
+    int first = 0, last = m_listEntries.size();
+    while (first < last) {
+        int middle = (first + last) / 2;
+        if (m_listEntries[middle]->remainingDays() < 0) first = middle + 1;
+        else last = middle;
+    }
+    return first;
+}
+
+int BirthdayList::Model::todayEventCount() const
+{
+    int count = 0;
+    for (int i = firstUpcomingEntry(); i < m_listEntries.size() && m_listEntries[i]->remainingDays() == 0; ++i) {
+        if (m_listEntries[i]->hasEvent()) ++count;
+    }
+    return count;
+}
+
+QList<const BirthdayList::AbstractAnnualEventEntry*> BirthdayList::Model::upcomingEntries(int maxEntries) const
+{
+    QList<const AbstractAnnualEventEntry*> entries;
+    for (int i = firstUpcomingEntry(); i < m_listEntries.size() && entries.size() < maxEntries; ++i) {
+        const AbstractAnnualEventEntry *entry = m_listEntries[i];
+        if (entry->remainingDays() > m_conf.eventThreshold) break;
+        if (entry->hasEvent()) entries.append(entry);
+    }
+    return entries;
+}
+
+QList<const BirthdayList::AbstractAnnualEventEntry*> BirthdayList::Model::sampleVisibleEntries(int sampleSize) const
+{
+    if (m_visibleEntries.size() <= sampleSize) return m_visibleEntries;
+
+    QList<const AbstractAnnualEventEntry*> sample;
+    for (int i=0; i<sampleSize; ++i) {
+        sample.append(m_visibleEntries[qint64(i) * m_visibleEntries.size() / sampleSize]);
+    }
+    return sample;
+}
+
+void BirthdayList::Model::reportMemoryUsage()
+{
+    MemoryReport report;
+    if (m_source_contacts) m_source_contacts->accountMemory(report);
+
+    // the entries of the calendar template are in the event list too, they are accounted with the calendar
+    qint64 entryBytes = MemoryReport::listBytes(m_listEntries);
+    qint64 entries = 0;
+    foreach (const AbstractAnnualEventEntry *entry, m_listEntries) {
+        if (m_calendarTemplateDays.value(calendarDayKey(entry->date())) == entry) continue;
+        entryBytes += entry->heapBytes();
+        ++entries;
+    }
+    report.add("eventEntries", entryBytes, entries);
+
+    qint64 calendarBytes = MemoryReport::hashBytes(m_curLangNamedayList) + MemoryReport::listBytes(m_calendarTemplate) +
+        MemoryReport::hashBytes(m_calendarTemplateDays);
+    QHashIterator<QString, QString> namedayIt(m_curLangNamedayList);
+    while (namedayIt.hasNext()) {
+        namedayIt.next();
+        calendarBytes += MemoryReport::stringBytes(namedayIt.key()) + MemoryReport::stringBytes(namedayIt.value());
+    }
+    foreach (const AggregatedNamedayEntry *calendarEntry, m_calendarTemplate) {
+        calendarBytes += calendarEntry->heapBytes();
+    }
+    report.add("namedayCalendar", calendarBytes, m_curLangNamedayList.size());
+
+    report.add("visibleEntryIndex", MemoryReport::listBytes(m_visibleEntries) + MemoryReport::hashBytes(m_unpopulatedItems),
+               m_visibleEntries.size());
+
+    for (int row=0; row<rowCount(); ++row) {
+        for (int column=0; column<columnCount(); ++column) {
+            const QStandardItem *rowItem = item(row, column);
+            if (rowItem) accountItemMemory(rowItem, report);
+        }
+    }
+
+    report.publish();
+}
+
+void BirthdayList::Model::accountItemMemory(const QStandardItem *item, MemoryReport &report)
+{
+    // the item with its private data (parent, model, vectors of children and values),
+    // each of the values holds the role and a QVariant
+    static const qint64 itemBytes = MemoryReport::allocationBytes(2 * sizeof(void*)) + MemoryReport::allocationBytes(64);
+    static const qint64 valueBytes = sizeof(int) + sizeof(QVariant);
+
+    qint64 bytes = itemBytes + MemoryReport::allocationBytes(16 + 3 * valueBytes) + MemoryReport::stringBytes(item->text());
+    if (item->hasChildren()) bytes += MemoryReport::allocationBytes(16 + item->rowCount() * item->columnCount() * sizeof(void*));
+    report.add("standardItems", bytes);
+
+    for (int row=0; row<item->rowCount(); ++row) {
+        for (int column=0; column<item->columnCount(); ++column) {
+            const QStandardItem *child = item->child(row, column);
+            if (child) accountItemMemory(child, report);
+        }
+    }
+}
+
+int BirthdayList::Model::eventCount() const
+{
+    return m_listEntries.size();
+}
+
+QString BirthdayList::Model::checkEventTiming() const
+{
+    // every event must fall into the year starting pastThreshold days ago
+    const QDate today = m_clock->currentDate();
+    const int lastDay = today.addDays(-m_conf.pastThreshold).daysTo(today.addDays(-m_conf.pastThreshold).addYears(1)) - m_conf.pastThreshold;
+
+    foreach(const AbstractAnnualEventEntry *entry, m_listEntries) {
+        int remainingDays = entry->remainingDays();
+        if (remainingDays < -m_conf.pastThreshold || remainingDays > lastDay) {
+            return QString("%1 (%2) is %3 days away").arg(entry->name()).arg(entry->date().toString(Qt::ISODate)).arg(remainingDays);
+        }
+    }
+
+    return QString();
+}
@@ -25,6 +25,10 @@
 
 namespace BirthdayList {
     class AbstractAnnualEventEntry;
+    class Clock;
+    class AggregatedNamedayEntry;
+    class MemoryReport;
+    class NamedayEntry;
     class Source_Collections;
     class Source_Contacts;
     class AddresseeInfo;
@@ -96,18 +100,106 @@ namespace BirthdayList
     {
         Q_OBJECT
     public:
-        explicit Model();
+        /** The model takes the ownership of the collection source; if none is given, the collection and contact sources
+         *  are shared with the other models of the process (see SharedSources) */
+        explicit Model(Source_Collections *sourceCollections = 0);
         ~Model();
+
+        enum ItemDataRole {
+            /** Identification of the event shown in the row (stays the same when the model is refreshed) */
+            EventKeyRole = Qt::UserRole + 1
+        };
         
         void setConfiguration(ModelConfiguration newConf);
         ModelConfiguration getConfiguration() const;
         
         QHash<QString, int> getAkonadiCollections();
+
+        /** Postpones the registration of the Akonadi contact source until startSources is called, the configuration
+         *  is only remembered meanwhile (keeps the Akonadi session and monitors off the desktop startup path) */
+        void holdSources();
+        /** Registers the contact source postponed by holdSources */
+        void startSources();
+        bool sourcesStarted() const {
+            return !m_sourcesHeld;
+        }
+
+        /** While suspended (the applet is hidden), the contact source only marks its changes and the tree rows are
+         *  not rebuilt; the event list is still kept up to date for the panel summary. Resuming catches up at once. */
+        void setSuspended(bool suspended);
+        bool isSuspended() const {
+            return m_suspended;
+        }
+
+        /** Replaces the current contact source (the model takes the ownership of the source) */
+        void setContactSource(Source_Contacts *source);
+
+        /** Replaces the source of the current date (the system clock is used by default); the clock is not owned by the model */
+        void setClock(Clock *clock);
+        /** Updates the events for the new current day and schedules the next update to the midnight */
+        void performDayRollover();
+
+        /** Returns the number of events (including those not visible in the current period) */
+        int eventCount() const;
+        /** Returns the description of the first event with timing inconsistent with the current day, or an empty string */
+        QString checkEventTiming() const;
+
+        /** Returns the number of today's events (computed from the sorted event list, no model items are needed) */
+        int todayEventCount() const;
+        /** Returns up to the given number of the nearest events from today to the end of the visualised period
+         *  (computed from the sorted event list, no model items are needed) */
+        QList<const AbstractAnnualEventEntry*> upcomingEntries(int maxEntries) const;
+
+        /** Returns up to the given number of visible entries spread evenly over the whole list
+         *  (including the entries without rows yet), used to estimate the column widths */
+        QList<const AbstractAnnualEventEntry*> sampleVisibleEntries(int sampleSize) const;
+
+        /** Estimates the heap used by the contacts, events, model items and the nameday calendar and publishes
+         *  it in the diagnostics (walks all structures, so it's done only on request) */
+        void reportMemoryUsage();
+
+        /** The top-level rows are created in pages as the view scrolls down,
+         *  the children of aggregated entries are created when they are expanded */
+        virtual bool canFetchMore(const QModelIndex &parent) const;
+        virtual void fetchMore(const QModelIndex &parent);
+        virtual bool hasChildren(const QModelIndex &parent = QModelIndex()) const;
+
+        /** Orders the visible entries by the given column (the sorting is done on the entries, not on the model items) */
+        virtual void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
         
-    private:
+    protected:
+        // the stages of the refresh are protected, so that a subclass can measure them one by one (see ModelBenchmark)
+
+        /** Reads the nameday definitions from the given calendar file */
+        void loadNamedayCalendar(const QString &fileName);
+        /** Checks if the contact passes the contact filter */
+        bool isContactAccepted(const AddresseeInfo &contactInfo) const;
+        /** Returns the nameday of the contact determined according to the configured nameday identification */
+        QDate getContactNameday(const AddresseeInfo &contactInfo);
+        /** Creates the birthday and anniversary entries of the contact (nameday entries are stored separately) */
+        void createContactEntries(const AddresseeInfo &contactInfo, const QDate &contactNameday, QList<NamedayEntry*> &namedayEntries);
+        /** Adds the nameday entries to the event list, aggregated according to the nameday display mode */
+        void aggregateNamedayEntries(QList<NamedayEntry*> &namedayEntries, const QDate &today);
         QDate getContactDateField(const AddresseeInfo &contactInfo, QString fieldName);
         /** Returns the nameday date by comparing the contact's given name with the calendar entries */
         QDate getNamedayByGivenName(QString givenName);
+        /** Recreates the event list from the contacts of the contact source */
+        void refreshContactEvents();
+        /** Deletes the event entries (except of the calendar template ones) and forgets the visible entries */
+        void deleteEventEntries();
+        /** Recreates the rows of the visible events from the event list */
+        void updateModel();
+
+        /** Returns the complete event list sorted by time */
+        const QList<AbstractAnnualEventEntry*> &eventEntries() const {
+            return m_listEntries;
+        }
+        /** Returns the names of the current nameday calendar by the date (in the MM-dd format) */
+        const QHash<QString, QString> &namedayCalendar() const {
+            return m_curLangNamedayList;
+        }
+
+    private:
         /** Returns the name from the current nameday calendar belonging to the given date. */
         QString getNamedayString(QDate date);
         /** Sets the colors for the model items according to the applet configuration */
@@ -115,19 +207,80 @@ namespace BirthdayList
 
         ModelConfiguration m_conf;
         
+        /** Returns the collection source (created when needed for the first time) */
+        Source_Collections &sourceCollections();
+        /** Replaces the contact source by the Akonadi source of the configured collection */
+        void registerAkonadiSource();
+        /** Replaces the contact source; a shared source is released instead of deleted when replaced */
+        void replaceContactSource(Source_Contacts *source, bool shared);
+
         Source_Collections *m_source_collections;
         Source_Contacts *m_source_contacts;
+        /** The sources are owned by SharedSources, not by this model */
+        bool m_sharedCollections;
+        bool m_sharedContactSource;
+        /** See holdSources */
+        bool m_sourcesHeld;
+        /** The configured contact source has not been registered yet because the sources are held */
+        bool m_contactSourcePending;
+        /** See setSuspended */
+        bool m_suspended;
+        /** The event list changed while suspended, the rows have to be rebuilt on resume */
+        bool m_modelUpdatePending;
         
+        Clock *m_clock;
         QTimer m_midnightTimer;
         
         /** Complete event list */
         QList<AbstractAnnualEventEntry*> m_listEntries;
+        /** Sorted events within the visualised period (rows of the model) */
+        QList<const AbstractAnnualEventEntry*> m_visibleEntries;
+        /** Number of visible events that have been already added to the model as top-level rows */
+        int m_loadedEntries;
+        /** Items of the entries whose child rows have not been created yet */
+        QHash<QStandardItem*, const AbstractAnnualEventEntry*> m_unpopulatedItems;
+        /** Column and order selected by the user for sorting the visible entries */
+        int m_sortColumn;
+        Qt::SortOrder m_sortOrder;
+        /** Number of top-level rows added to the model at once */
+        static const int m_rowPageSize = 32;
 
         /** Local copy of the currently used nameday calendar */
         QHash<QString, QString> m_curLangNamedayList;
+
+        /** Nameday entries for every day of the visualised period (used if all calendar names are shown);
+         *  they are reused by all refreshes until the calendar, date format or the period changes */
+        QList<AggregatedNamedayEntry*> m_calendarTemplate;
+        /** Entries of the calendar template indexed by calendarDayKey */
+        QHash<int, AggregatedNamedayEntry*> m_calendarTemplateDays;
+        /** Identification of the calendar, date format and period, for which the calendar template was prepared */
+        QString m_calendarTemplateKey;
+
+        static int calendarDayKey(const QDate &date) {
+            return 100 * date.month() + date.day();
+        }
         
-        void refreshContactEvents();
-        void updateModel();
+        /** Prepares the calendar template for the current visualised period (if not prepared yet) */
+        void updateCalendarTemplate();
+        void deleteCalendarTemplate();
+        /** Plans the midnight update according to the current clock */
+        void scheduleMidnightUpdate();
+        /** Adds up to rowCount next visible events to the model */
+        void appendEntryRows(int rowCount);
+        /** Creates the child rows of the entry represented by the given item */
+        void populateEntryChildren(QStandardItem *item);
+        /** Orders the visible entries according to the sort column selected by the user */
+        void sortVisibleEntries();
+        /** Returns the index of the first entry of the sorted event list that is not in the past */
+        int firstUpcomingEntry() const;
+        /** Adds the estimated heap of the given item and its children to the report */
+        static void accountItemMemory(const QStandardItem *item, MemoryReport &report);
+        static bool nameLessThan(const AbstractAnnualEventEntry *a, const AbstractAnnualEventEntry *b);
+        static bool ageLessThan(const AbstractAnnualEventEntry *a, const AbstractAnnualEventEntry *b);
+
+    signals:
+        /** Emitted when the event list has been recreated */
+        void eventsUpdated();
 
     private slots:
         void contactCollectionUpdated();
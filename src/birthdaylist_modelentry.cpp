@@ -17,11 +17,14 @@
 
 
 #include "birthdaylist_modelentry.h"
+#include "birthdaylist_eventtiming.h"
+#include "birthdaylist_memoryreport.h"
 #include <KLocalizedString>
 #include <QStandardItemModel>
+#include <QVector>
+#include <string.h>
 
 
-int BirthdayList::AbstractAnnualEventEntry::m_pastThreshold = 7;
 KIcon BirthdayList::BirthdayEntry::m_icon("bl_cookie.png");
 KIcon BirthdayList::NamedayEntry::m_icon("bl_date.png");
 KIcon BirthdayList::AggregatedNamedayEntry::m_icon("bl_date.png");
@@ -29,31 +32,118 @@ KIcon BirthdayList::AnniversaryEntry::m_icon("bl_rings.png");
 
 
 BirthdayList::AbstractAnnualEventEntry::AbstractAnnualEventEntry(const QString &name, const QDate &date, QString email, QString url)
-: m_name(name), m_date(date), m_email(email), m_url(url) 
+: m_name(name), m_age(0), m_date(date), m_remainingDays(0), m_email(email), m_url(url) 
 {
-    QDate today = QDate::currentDate();
+    // the timing is computed for all entries at once by updateTiming
+    updateSortKey();
+    m_nameCollationKey = collationKey(m_name);
+}
 
-    m_currentAnniversary = QDate(today.year(), m_date.month(), m_date.day());
-    int daysToAnniversary = today.daysTo(m_currentAnniversary);
-    if (daysToAnniversary < -m_pastThreshold) {
-        m_currentAnniversary = QDate(today.year() + 1, m_date.month(), m_date.day());
-    } else if (daysToAnniversary > today.daysInYear() - m_pastThreshold) {
-        m_currentAnniversary = QDate(today.year() - 1, m_date.month(), m_date.day());
-    }
+BirthdayList::AbstractAnnualEventEntry::~AbstractAnnualEventEntry() 
+{
+}
 
-    m_remainingDays = today.daysTo(m_currentAnniversary);
-    m_age = m_currentAnniversary.year() - m_date.year();
+int BirthdayList::AbstractAnnualEventEntry::childCount() const
+{
+    return 0;
 }
 
-BirthdayList::AbstractAnnualEventEntry::~AbstractAnnualEventEntry() 
+void BirthdayList::AbstractAnnualEventEntry::createChildModelItems(QStandardItem *parentItem, QString dateFormat) const
+{
+    Q_UNUSED(parentItem);
+    Q_UNUSED(dateFormat);
+}
+
+qint64 BirthdayList::AbstractAnnualEventEntry::heapBytes() const
 {
+    // the entry types other than the aggregated one add no more than padding to the common members
+    return MemoryReport::allocationBytes(sizeof(AbstractAnnualEventEntry)) + MemoryReport::stringBytes(m_name) +
+        MemoryReport::stringBytes(m_email) + MemoryReport::stringBytes(m_url) +
+        (m_nameCollationKey.isEmpty() ? 0 : MemoryReport::allocationBytes(24 + m_nameCollationKey.capacity()));
 }
 
 bool BirthdayList::AbstractAnnualEventEntry::lessThan(const AbstractAnnualEventEntry *a, const AbstractAnnualEventEntry *b) 
 {
-    if (a->m_remainingDays != b->m_remainingDays) return a->m_remainingDays < b->m_remainingDays;
-    else if (a->m_age != b->m_age) return a->m_age < b->m_age;
-    else return a->m_name < b->m_name;
+    if (a->m_sortKey != b->m_sortKey) return a->m_sortKey < b->m_sortKey;
+    else return a->m_nameCollationKey < b->m_nameCollationKey;
+}
+
+void BirthdayList::AbstractAnnualEventEntry::updateTiming(const QList<AbstractAnnualEventEntry*> &entries, const QDate &today, int pastThreshold) 
+{
+    AnnualEventTiming timing;
+    timing.reserve(entries.size());
+    foreach(const AbstractAnnualEventEntry *entry, entries) {
+        timing.append(entry->m_date);
+    }
+
+    timing.compute(today, pastThreshold);
+
+    for (int i=0; i<entries.size(); ++i) {
+        AbstractAnnualEventEntry *entry = entries[i];
+        entry->m_currentAnniversary = timing.currentAnniversary(i);
+        entry->m_remainingDays = timing.remainingDays(i);
+        entry->m_age = timing.age(i);
+        entry->updateSortKey();
+    }
+}
+
+void BirthdayList::AbstractAnnualEventEntry::sortEntries(QList<AbstractAnnualEventEntry*> &entries) 
+{
+    if (entries.size() < 2) return;
+
+    int minRemainingDays = entries[0]->m_remainingDays;
+    int maxRemainingDays = minRemainingDays;
+    foreach(const AbstractAnnualEventEntry *entry, entries) {
+        minRemainingDays = qMin(minRemainingDays, entry->m_remainingDays);
+        maxRemainingDays = qMax(maxRemainingDays, entry->m_remainingDays);
+    }
+
+    // the remaining days are normally limited to about one year; don't allocate the buckets for anything unexpected
+    if (maxRemainingDays - minRemainingDays > 4096) {
+        qSort(entries.begin(), entries.end(), lessThan);
+        return;
+    }
+
+    // counting sort by the remaining days
+    QVector<int> bucketEnds(maxRemainingDays - minRemainingDays + 2, 0);
+    foreach(const AbstractAnnualEventEntry *entry, entries) {
+        ++bucketEnds[entry->m_remainingDays - minRemainingDays + 1];
+    }
+    for (int i=1; i<bucketEnds.size(); ++i) bucketEnds[i] += bucketEnds[i-1];
+
+    QVector<AbstractAnnualEventEntry*> sortedEntries(entries.size());
+    foreach(AbstractAnnualEventEntry *entry, entries) {
+        sortedEntries[bucketEnds[entry->m_remainingDays - minRemainingDays]++] = entry;
+    }
+
+    // now every bucket ends where the next one begins; order the entries of the same day by age and name
+    int bucketBegin = 0;
+    for (int i=0; i<bucketEnds.size() - 1; ++i) {
+        int bucketEnd = bucketEnds[i];
+        if (bucketEnd - bucketBegin > 1) qSort(sortedEntries.begin() + bucketBegin, sortedEntries.begin() + bucketEnd, lessThan);
+        bucketBegin = bucketEnd;
+    }
+
+    for (int i=0; i<sortedEntries.size(); ++i) entries[i] = sortedEntries[i];
+}
+
+void BirthdayList::AbstractAnnualEventEntry::updateSortKey() 
+{
+    // flipping the sign bit keeps the order of signed values when compared as unsigned ones
+    m_sortKey = (quint64(quint32(m_remainingDays) ^ 0x80000000u) << 32) | quint64(quint32(m_age) ^ 0x80000000u);
+}
+
+QByteArray BirthdayList::AbstractAnnualEventEntry::collationKey(const QString &string) 
+{
+    // strxfrm uses the same collation rules as QString::localeAwareCompare
+    QByteArray localString = string.toLocal8Bit();
+    size_t keyLength = strxfrm(0, localString.constData(), 0);
+
+    QByteArray key;
+    key.resize(keyLength + 1);
+    strxfrm(key.data(), localString.constData(), keyLength + 1);
+    key.resize(keyLength);
+    return key;
 }
 
 QString BirthdayList::AbstractAnnualEventEntry::remainingDaysString(const int remainingDays) 
@@ -134,17 +224,28 @@ BirthdayList::AggregatedNamedayEntry::AggregatedNamedayEntry(const QString &name
 
 BirthdayList::AggregatedNamedayEntry::~AggregatedNamedayEntry() 
 {
+    clearNamedayEntries();
+}
+
+void BirthdayList::AggregatedNamedayEntry::addNamedayEntry(NamedayEntry *namedayEntry) 
+{
+    namedayEntry->setAggregated(true);
+    m_storedEntries.append(namedayEntry);
+}
 
+void BirthdayList::AggregatedNamedayEntry::clearNamedayEntries() 
+{
     foreach(NamedayEntry *storedEntry, m_storedEntries) {
         delete storedEntry;
     }
     m_storedEntries.clear();
 }
 
-void BirthdayList::AggregatedNamedayEntry::addNamedayEntry(NamedayEntry *namedayEntry) 
+void BirthdayList::AggregatedNamedayEntry::cacheDisplayStrings(const QString &dateFormat) 
 {
-    namedayEntry->setAggregated(true);
-    m_storedEntries.append(namedayEntry);
+    m_cachedDateFormat = dateFormat;
+    m_cachedDateString = m_currentAnniversary.toString(dateFormat);
+    m_cachedRemainingDaysString = remainingDaysString(remainingDays());
 }
 
 void BirthdayList::AggregatedNamedayEntry::createModelItems(QList<QStandardItem*> &items, QString dateFormat) const 
@@ -153,15 +254,30 @@ void BirthdayList::AggregatedNamedayEntry::createModelItems(QList<QStandardItem*
     else items.append(new QStandardItem(QString("%1 (%2)").arg(m_name).arg(m_storedEntries.size())));
     items[0]->setIcon(AggregatedNamedayEntry::m_icon);
     items.append(new QStandardItem(""));
-    items.append(new QStandardItem(m_currentAnniversary.toString(dateFormat)));
-    items.append(new QStandardItem(remainingDaysString(remainingDays())));
+    if (!m_cachedDateFormat.isNull() && m_cachedDateFormat == dateFormat) {
+        items.append(new QStandardItem(m_cachedDateString));
+        items.append(new QStandardItem(m_cachedRemainingDaysString));
+    } else {
+        items.append(new QStandardItem(m_currentAnniversary.toString(dateFormat)));
+        items.append(new QStandardItem(remainingDaysString(remainingDays())));
+    }
     items.append(new QStandardItem(""));
     items.append(new QStandardItem(""));
 
+    // the rows of the stored entries are created on demand (see createChildModelItems)
+}
+
+int BirthdayList::AggregatedNamedayEntry::childCount() const
+{
+    return m_storedEntries.size();
+}
+
+void BirthdayList::AggregatedNamedayEntry::createChildModelItems(QStandardItem *parentItem, QString dateFormat) const
+{
     foreach(NamedayEntry *storedEntry, m_storedEntries) {
         QList<QStandardItem*> storedEntryItems;
         storedEntry->createModelItems(storedEntryItems, dateFormat);
-        items[0]->appendRow(storedEntryItems);
+        parentItem->appendRow(storedEntryItems);
     }
 }
 
@@ -170,6 +286,19 @@ bool BirthdayList::AggregatedNamedayEntry::hasEvent() const
     return !m_storedEntries.empty();
 }
 
+qint64 BirthdayList::AggregatedNamedayEntry::heapBytes() const
+{
+    // replace the size of the common members by the size of this entry
+    qint64 bytes = AbstractAnnualEventEntry::heapBytes() - MemoryReport::allocationBytes(sizeof(AbstractAnnualEventEntry)) +
+        MemoryReport::allocationBytes(sizeof(AggregatedNamedayEntry)) + MemoryReport::listBytes(m_storedEntries) +
+        MemoryReport::stringBytes(m_cachedDateFormat) + MemoryReport::stringBytes(m_cachedDateString) +
+        MemoryReport::stringBytes(m_cachedRemainingDaysString);
+    foreach(const NamedayEntry *storedEntry, m_storedEntries) {
+        bytes += storedEntry->heapBytes();
+    }
+    return bytes;
+}
+
 
 BirthdayList::AnniversaryEntry::AnniversaryEntry(const QString &name, const QDate &date, QString email, QString url)
 : AbstractAnnualEventEntry(name, date, email, url) 
@@ -21,6 +21,7 @@
 
 #include <KDebug>
 #include <KIcon>
+#include <QByteArray>
 #include <QDate>
 #include <QStandardItem>
 #include <QString>
@@ -57,25 +58,52 @@ namespace BirthdayList
             return m_remainingDays;
         }
 
+        /** Returns the key ordering the entries by the remaining days and the age (names must be compared separately). */
+        quint64 sortKey() const {
+            return m_sortKey;
+        }
+
+        /** Returns the key ordering the entries by the name according to the collation rules of the current locale. */
+        const QByteArray& nameCollationKey() const {
+            return m_nameCollationKey;
+        }
+
         /** Creates the representation of this entry in the tree view's model. */
         virtual void createModelItems(QList<QStandardItem*> &items, QString dateFormat) const = 0;
 
+        /** Returns the number of child rows shown under this entry in the tree view. */
+        virtual int childCount() const;
+
+        /** Creates the child rows of this entry under the given item (called only when the item is expanded). */
+        virtual void createChildModelItems(QStandardItem *parentItem, QString dateFormat) const;
+
         /** Indicates if this entry is bound to one or more events in the selected address book. */
         virtual bool hasEvent() const = 0;
 
+        /** Returns the estimated heap used by this entry, including its strings (see MemoryReport). */
+        virtual qint64 heapBytes() const;
+
         /** Comparator used to sort the event entries by time. */
         static bool lessThan(const AbstractAnnualEventEntry *a, const AbstractAnnualEventEntry *b);
 
-        /** Sets the number of days in the past, which will be taken as the boundary between the
-        *  past and future events */
-        static void setPastThreshold(int threshold) {
-            m_pastThreshold = threshold;
-        }
+        /** Computes the current anniversaries, remaining days and ages of the given entries relative to the given day;
+        *  the events up to pastThreshold days ago are taken as past, the older ones as next year's
+        *  (the entries have no valid timing until this is called) */
+        static void updateTiming(const QList<AbstractAnnualEventEntry*> &entries, const QDate &today, int pastThreshold);
+
+        /** Sorts the event entries by time (same order as lessThan, but distributes the entries
+        *  by the remaining days first so that only the entries of the same day need to be compared) */
+        static void sortEntries(QList<AbstractAnnualEventEntry*> &entries);
 
-    protected:
         /** Turns the number of remaining days to a readable text. */
         static QString remainingDaysString(const int remainingDays);
 
+    protected:
+        /** Packs the remaining days and the age into the sort key. */
+        void updateSortKey();
+        /** Transforms the string to a key that can be compared bytewise according to the current locale. */
+        static QByteArray collationKey(const QString &string);
+
     protected:
         QString m_name;
         int m_age;
@@ -84,8 +112,8 @@ namespace BirthdayList
         int m_remainingDays;
         QString m_email;
         QString m_url;
-
-        static int m_pastThreshold;
+        quint64 m_sortKey;
+        QByteArray m_nameCollationKey;
     };
 
 
@@ -137,12 +165,23 @@ namespace BirthdayList
 
         /** Registers the given nameday entry in the aggregation. */
         void addNamedayEntry(NamedayEntry *namedayEntry);
+        /** Deletes all registered nameday entries. */
+        void clearNamedayEntries();
+
+        /** Formats the date and remaining days in advance (used by entries reused across several model refreshes). */
+        void cacheDisplayStrings(const QString &dateFormat);
 
         virtual void createModelItems(QList<QStandardItem*> &items, QString dateFormat) const;
+        virtual int childCount() const;
+        virtual void createChildModelItems(QStandardItem *parentItem, QString dateFormat) const;
         virtual bool hasEvent() const;
+        virtual qint64 heapBytes() const;
 
     private:
         QList<NamedayEntry *> m_storedEntries;
+        QString m_cachedDateFormat;
+        QString m_cachedDateString;
+        QString m_cachedRemainingDaysString;
         static KIcon m_icon;
     };
 
@@ -0,0 +1,115 @@
+/**
+ * @file    birthdaylist_sharedsources.cpp
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+
+#include "birthdaylist_sharedsources.h"
+#include "birthdaylist_diagnostics.h"
+#include "birthdaylist_source_akonadi.h"
+#include "birthdaylist_source_collections.h"
+#include <KDebug>
+
+
+BirthdayList::SharedSources::SharedSources()
+: m_collections(0),
+m_collectionsReferences(0)
+{
+}
+
+BirthdayList::SharedSources::~SharedSources()
+{
+}
+
+BirthdayList::SharedSources *BirthdayList::SharedSources::instance()
+{
+    static SharedSources sharedSources;
+    return &sharedSources;
+}
+
+BirthdayList::Source_Collections *BirthdayList::SharedSources::acquireCollections()
+{
+    if (!m_collections) m_collections = new Source_Collections();
+    ++m_collectionsReferences;
+    return m_collections;
+}
+
+void BirthdayList::SharedSources::releaseCollections(Source_Collections *sourceCollections)
+{
+    if (sourceCollections != m_collections || m_collectionsReferences <= 0) return;
+
+    if (--m_collectionsReferences == 0) {
+        delete m_collections;
+        m_collections = 0;
+    }
+}
+
+BirthdayList::Source_Akonadi *BirthdayList::SharedSources::acquireAkonadiSource(Akonadi::Collection::Id collectionId, const void *client)
+{
+    SharedContactSource &shared = m_contactSources[collectionId];
+    if (!shared.source) {
+        kDebug() << "Creating the shared contact source of Akonadi collection Id" << collectionId;
+        // the contact source holds a reference to the collection source until it is released
+        shared.source = new Source_Akonadi(*acquireCollections());
+        shared.source->setCurrentCollection(collectionId);
+    }
+    else kDebug() << "Sharing the contact source of Akonadi collection Id" << collectionId << "with" << shared.references << "models";
+
+    ++shared.references;
+    shared.activeClients.insert(client);
+    shared.source->setSuspended(false);
+    Diagnostics::instance()->setCounter("sharedContactSources", m_contactSources.size());
+    return shared.source;
+}
+
+void BirthdayList::SharedSources::releaseAkonadiSource(Source_Akonadi *source, const void *client)
+{
+    Akonadi::Collection::Id key = contactSourceKey(source);
+    if (key == -2) return;
+
+    SharedContactSource &shared = m_contactSources[key];
+    shared.activeClients.remove(client);
+    if (--shared.references > 0) {
+        if (shared.activeClients.isEmpty()) shared.source->setSuspended(true);
+        return;
+    }
+
+    m_contactSources.remove(key);
+    delete source;
+    releaseCollections(m_collections);
+    Diagnostics::instance()->setCounter("sharedContactSources", m_contactSources.size());
+}
+
+void BirthdayList::SharedSources::setClientSuspended(Source_Contacts *source, const void *client, bool suspended)
+{
+    Akonadi::Collection::Id key = contactSourceKey(source);
+    if (key == -2) return;
+
+    SharedContactSource &shared = m_contactSources[key];
+    if (suspended) shared.activeClients.remove(client);
+    else shared.activeClients.insert(client);
+    shared.source->setSuspended(shared.activeClients.isEmpty());
+}
+
+Akonadi::Collection::Id BirthdayList::SharedSources::contactSourceKey(const Source_Contacts *source) const
+{
+    QHashIterator<Akonadi::Collection::Id, SharedContactSource> sourceIt(m_contactSources);
+    while (sourceIt.hasNext()) {
+        sourceIt.next();
+        if (sourceIt.value().source == source) return sourceIt.key();
+    }
+    return -2;
+}
@@ -0,0 +1,83 @@
+#ifndef BIRTHDAYLIST_SHAREDSOURCES_H
+#define BIRTHDAYLIST_SHAREDSOURCES_H
+
+/**
+ * @file    birthdaylist_sharedsources.h
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+
+#include <Akonadi/Collection>
+#include <QHash>
+#include <QSet>
+
+namespace BirthdayList {
+    class Source_Akonadi;
+    class Source_Collections;
+    class Source_Contacts;
+};
+
+
+namespace BirthdayList 
+{
+    /**
+    * Process-wide registry of the Akonadi sources shared by all applet instances: one collection source
+    * (Akonadi session and collection monitor) and one contact source per collection (monitor and contacts).
+    * The sources are reference counted and deleted with the last model using them; every model keeps
+    * its own filter and visualised period.
+    */
+    class SharedSources
+    {
+    public:
+        static SharedSources *instance();
+
+        /** Returns the collection source, creating it for the first client */
+        Source_Collections *acquireCollections();
+        void releaseCollections(Source_Collections *sourceCollections);
+
+        /** Returns the contact source of the given collection, creating it for the first client
+         *  (the client is counted as active, see setClientSuspended) */
+        Source_Akonadi *acquireAkonadiSource(Akonadi::Collection::Id collectionId, const void *client);
+        void releaseAkonadiSource(Source_Akonadi *source, const void *client);
+
+        /** Suspends the shared contact source only when all its clients are suspended */
+        void setClientSuspended(Source_Contacts *source, const void *client, bool suspended);
+
+    private:
+        SharedSources();
+        ~SharedSources();
+
+        struct SharedContactSource
+        {
+            SharedContactSource() : source(0), references(0) {}
+
+            Source_Akonadi *source;
+            int references;
+            /** Clients that are not suspended */
+            QSet<const void*> activeClients;
+        };
+
+        /** Returns the key of the given source in m_contactSources, or -2 if it is not shared */
+        Akonadi::Collection::Id contactSourceKey(const Source_Contacts *source) const;
+
+        Source_Collections *m_collections;
+        int m_collectionsReferences;
+        QHash<Akonadi::Collection::Id, SharedContactSource> m_contactSources;
+    };
+};
+
+
+#endif //BIRTHDAYLIST_SHAREDSOURCES_H
@@ -17,23 +17,54 @@
 
 
 #include "birthdaylist_source_akonadi.h"
+#include "birthdaylist_diagnostics.h"
+#include "birthdaylist_memoryreport.h"
 #include "birthdaylist_source_collections.h"
+#include "birthdaylist_trace.h"
 #include <Akonadi/ChangeRecorder>
 #include <Akonadi/Collection>
+#include <Akonadi/CollectionFetchJob>
 #include <Akonadi/EntityTreeModel>
+#include <Akonadi/ItemFetchJob>
 #include <Akonadi/ItemFetchScope>
 #include <Akonadi/Session>
 #include <KABC/Addressee>
+#include <KStandardDirs>
+#include <QFile>
+#include <QSettings>
+
+
+// identification of the contact cache file format
+static const quint32 ContactCacheMagic = 0x424c4343;
+static const qint32 ContactCacheVersion = 1;
 
 
 BirthdayList::Source_Akonadi::Source_Akonadi(const BirthdayList::Source_Collections &sourceCollections)
 : m_sourceCollections(sourceCollections),
-m_session(new Akonadi::Session("BirthdayList_Source_Akonadi", this)),
+m_session(0),
 m_currentCollectionId(-1),
 m_registeredCollectionId(-1),
 m_monitorAddressBook(0),
-m_contactsModel(0)
+m_contactsModel(0),
+m_injectedContactsModel(0),
+m_changeJournal(0),
+m_contactCacheDirty(false),
+m_ingestPending(false),
+m_changeStreamRecorder(0),
+m_replayInProgress(false)
 {
+    // diagnostics: BIRTHDAYLIST_RECORD_AKONADI=<file> records the signals of the contacts model with anonymized contacts,
+    // so that they can be replayed offline (see AkonadiStandIn::scriptRecording)
+    QString recordingFile = QString::fromLocal8Bit(qgetenv("BIRTHDAYLIST_RECORD_AKONADI"));
+    if (!recordingFile.isEmpty()) m_changeStreamRecorder = new ChangeStreamRecorder(recordingFile);
+
+    m_contactsUpdatedTimer.setSingleShot(true);
+    m_contactsUpdatedTimer.setInterval(0);
+    connect(&m_contactsUpdatedTimer, SIGNAL(timeout()), this, SLOT(contactsUpdatedTimeout()));
+    m_storeContactCacheTimer.setSingleShot(true);
+    m_storeContactCacheTimer.setInterval(m_storeContactCacheDelay);
+    connect(&m_storeContactCacheTimer, SIGNAL(timeout()), this, SLOT(storeContactCacheTimeout()));
+
     // register for notifications when there are changes in the list of Akonadi collections
     connect(&m_sourceCollections, SIGNAL(collectionsUpdated()), this, SLOT(collectionsUpdated()));
 }
@@ -42,6 +73,7 @@ BirthdayList::Source_Akonadi::~Source_Akonadi()
 {
     disconnect(&m_sourceCollections, SIGNAL(collectionsUpdated()), this, SLOT(collectionsUpdated()));
     unregisterFromCurrentCollection();
+    delete m_changeStreamRecorder;
     delete m_session;
 }
 
@@ -66,6 +98,43 @@ const QHash<QString, BirthdayList::AddresseeInfo>& BirthdayList::Source_Akonadi:
     return m_contacts;
 }
 
+void BirthdayList::Source_Akonadi::accountMemory(MemoryReport &report)
+{
+    Source_Contacts::accountMemory(report);
+
+    qint64 itemMapBytes = MemoryReport::hashBytes(m_itemUids) + MemoryReport::hashBytes(m_itemRevisions);
+    foreach (const QString &uid, m_itemUids) itemMapBytes += MemoryReport::stringBytes(uid);
+    report.add("akonadiItemMaps", itemMapBytes, m_itemUids.size());
+
+    // only the EntityTreeModel created by this source is accounted, the injected models belong to somebody else;
+    // its items carry the same contacts in KABC::Addressee payloads
+    if (m_contactsModel != 0 && m_contactsModel != m_injectedContactsModel) {
+        qint64 etmBytes = 0;
+        foreach (const QString &uid, m_itemUids) {
+            etmBytes += m_etmItemBytes + addresseeInfoBytes(m_contacts.value(uid));
+        }
+        report.add("akonadiEntityTreeModel", etmBytes, m_itemUids.size());
+    }
+}
+
+void BirthdayList::Source_Akonadi::setContactsModel(QAbstractItemModel *contactsModel)
+{
+    m_collectionRegistrationMutex.lock();
+
+    unregisterFromCurrentCollection();
+    m_injectedContactsModel = contactsModel;
+    tryRegisteringInCurrentCollection();
+
+    m_collectionRegistrationMutex.unlock();
+}
+
+Akonadi::Session *BirthdayList::Source_Akonadi::session()
+{
+    // the session connects to the Akonadi server, so it isn't created when the contacts are read from another model
+    if (m_session == 0) m_session = new Akonadi::Session("BirthdayList_Source_Akonadi", this);
+    return m_session;
+}
+
 void BirthdayList::Source_Akonadi::tryRegisteringInCurrentCollection() 
 {
     if (m_currentCollectionId != m_registeredCollectionId) {
@@ -74,6 +143,7 @@ void BirthdayList::Source_Akonadi::tryRegisteringInCurrentCollection()
             kDebug() << "Connecting to Akonadi collection" << newCollection.id() << newCollection.resource() << newCollection.name();
             registerInCollection(newCollection);
             m_registeredCollectionId = m_currentCollectionId;
+            Diagnostics::instance()->recordMilestone("akonadiSourceRegistered");
         }
         else {
             kDebug() << "Can't connect to Akonadi collection" << m_currentCollectionId << ", the collection model is not valid yet";
@@ -86,8 +156,21 @@ void BirthdayList::Source_Akonadi::tryRegisteringInCurrentCollection()
 
 void BirthdayList::Source_Akonadi::registerInCollection(const Akonadi::Collection &akonadiCollection) 
 {
+    if (m_injectedContactsModel != 0) {
+        kDebug() << "Reading the contacts of collection" << akonadiCollection.id() << "from the injected model";
+        connectContactsModel(m_injectedContactsModel);
+        updateContacts();
+        setInitialSyncDone(true);
+    }
+    else if (loadContactCache(akonadiCollection.id())) registerWithContactCache(akonadiCollection);
+    else registerWithFullFetch(akonadiCollection);
+}
+
+void BirthdayList::Source_Akonadi::registerWithFullFetch(const Akonadi::Collection &akonadiCollection) 
+{
+    kDebug() << "No valid contact cache for Akonadi collection" << akonadiCollection.id() << ", fetching the complete collection";
     m_monitorAddressBook = new Akonadi::ChangeRecorder(this);
-    m_monitorAddressBook->setSession(m_session);
+    m_monitorAddressBook->setSession(session());
     m_monitorAddressBook->setCollectionMonitored(akonadiCollection);
     m_monitorAddressBook->setMimeTypeMonitored(KABC::Addressee::mimeType());
     Akonadi::ItemFetchScope scopeAddressBook;
@@ -95,32 +178,112 @@ void BirthdayList::Source_Akonadi::registerInCollection(const Akonadi::Collectio
     scopeAddressBook.fetchAllAttributes(true);
     m_monitorAddressBook->setItemFetchScope(scopeAddressBook);
 
-    m_contactsModel = new Akonadi::EntityTreeModel(m_monitorAddressBook, this);
+    Akonadi::EntityTreeModel *entityTreeModel = new Akonadi::EntityTreeModel(m_monitorAddressBook, this);
+    connect(entityTreeModel, SIGNAL(collectionPopulated(Akonadi::Collection::Id)), this, SLOT(collectionPopulated(Akonadi::Collection::Id)));
+    connectContactsModel(entityTreeModel);
+}
+
+void BirthdayList::Source_Akonadi::connectContactsModel(QAbstractItemModel *contactsModel) 
+{
+    m_contactsModel = contactsModel;
     connect(m_contactsModel, SIGNAL(dataChanged(QModelIndex,QModelIndex)), this, SLOT(dataChanged(QModelIndex,QModelIndex)));
     connect(m_contactsModel, SIGNAL(rowsInserted(QModelIndex, int, int)), this, SLOT(rowsInserted(QModelIndex, int, int)));
     connect(m_contactsModel, SIGNAL(rowsRemoved(QModelIndex, int, int)), this, SLOT(rowsRemoved(QModelIndex, int, int)));
 }
 
+void BirthdayList::Source_Akonadi::registerWithContactCache(const Akonadi::Collection &akonadiCollection) 
+{
+    kDebug() << "Starting from" << m_contacts.size() << "cached contacts of Akonadi collection" << akonadiCollection.id();
+
+    // the change recorder keeps the notifications that have not been processed yet in the journal,
+    // so that they survive the restart of the applet and get replayed at the next start
+    m_changeJournal = new QSettings(changeJournalPath(akonadiCollection.id()), QSettings::IniFormat);
+    m_monitorAddressBook = new Akonadi::ChangeRecorder(this);
+    m_monitorAddressBook->setConfig(m_changeJournal);
+    m_monitorAddressBook->setChangeRecordingEnabled(true);
+    m_monitorAddressBook->setSession(session());
+    m_monitorAddressBook->setCollectionMonitored(akonadiCollection);
+    m_monitorAddressBook->setMimeTypeMonitored(KABC::Addressee::mimeType());
+    Akonadi::ItemFetchScope scopeAddressBook;
+    scopeAddressBook.fetchFullPayload(true);
+    scopeAddressBook.fetchAllAttributes(true);
+    m_monitorAddressBook->setItemFetchScope(scopeAddressBook);
+
+    connect(m_monitorAddressBook, SIGNAL(changesAdded()), this, SLOT(replayNextChange()));
+    connect(m_monitorAddressBook, SIGNAL(itemAdded(Akonadi::Item,Akonadi::Collection)), this, SLOT(journalItemAdded(Akonadi::Item,Akonadi::Collection)));
+    connect(m_monitorAddressBook, SIGNAL(itemChanged(Akonadi::Item,QSet<QByteArray>)), this, SLOT(journalItemChanged(Akonadi::Item,QSet<QByteArray>)));
+    connect(m_monitorAddressBook, SIGNAL(itemRemoved(Akonadi::Item)), this, SLOT(journalItemRemoved(Akonadi::Item)));
+    // every other recorded notification must be acknowledged too, otherwise the replay stops and the journal keeps growing
+    connect(m_monitorAddressBook, SIGNAL(itemMoved(Akonadi::Item,Akonadi::Collection,Akonadi::Collection)), this, SLOT(journalItemMoved(Akonadi::Item,Akonadi::Collection,Akonadi::Collection)));
+    connect(m_monitorAddressBook, SIGNAL(itemLinked(Akonadi::Item,Akonadi::Collection)), this, SLOT(journalChangeProcessed()));
+    connect(m_monitorAddressBook, SIGNAL(itemUnlinked(Akonadi::Item,Akonadi::Collection)), this, SLOT(journalChangeProcessed()));
+    connect(m_monitorAddressBook, SIGNAL(collectionAdded(Akonadi::Collection,Akonadi::Collection)), this, SLOT(journalChangeProcessed()));
+    connect(m_monitorAddressBook, SIGNAL(collectionChanged(Akonadi::Collection)), this, SLOT(journalChangeProcessed()));
+    connect(m_monitorAddressBook, SIGNAL(collectionMoved(Akonadi::Collection,Akonadi::Collection,Akonadi::Collection)), this, SLOT(journalChangeProcessed()));
+    connect(m_monitorAddressBook, SIGNAL(collectionRemoved(Akonadi::Collection)), this, SLOT(journalChangeProcessed()));
+    connect(m_monitorAddressBook, SIGNAL(collectionSubscribed(Akonadi::Collection,Akonadi::Collection)), this, SLOT(journalChangeProcessed()));
+    connect(m_monitorAddressBook, SIGNAL(collectionUnsubscribed(Akonadi::Collection)), this, SLOT(journalChangeProcessed()));
+    connect(m_monitorAddressBook, SIGNAL(nothingToReplay()), this, SLOT(journalChangeProcessed()));
+
+    // the cached contacts can be shown right away
+    m_contactsUpdatedTimer.start();
+
+    // catch up with the changes recorded during the last session
+    replayNextChange();
+
+    // the changes done while the applet was not running were not recorded, so compare the item revisions
+    // (without payloads) with the cached ones; only the items that differ will be fetched completely.
+    // The full fetch reads the whole collection tree, so the revisions are read from all subcollections as well
+    m_cachedCollectionIds.clear();
+    m_cachedCollectionIds.insert(akonadiCollection.id());
+    Akonadi::CollectionFetchJob *subcollectionsJob = new Akonadi::CollectionFetchJob(akonadiCollection, Akonadi::CollectionFetchJob::Recursive, session());
+    connect(subcollectionsJob, SIGNAL(result(KJob*)), this, SLOT(subcollectionsFetched(KJob*)));
+    m_cacheValidationJobs.append(subcollectionsJob);
+}
+
 void BirthdayList::Source_Akonadi::unregisterFromCurrentCollection() 
 {
+    if (m_contactCacheDirty) storeContactCache();
+
     if (m_contactsModel != 0) {
         kDebug() << "Disconnecting from Akonadi collection" << m_currentCollectionId;
-        m_registeredCollectionId = -1;
         
         disconnect(m_contactsModel, SIGNAL(dataChanged(QModelIndex,QModelIndex)), this, SLOT(dataChanged(QModelIndex,QModelIndex)));
         disconnect(m_contactsModel, SIGNAL(rowsInserted(QModelIndex, int, int)), this, SLOT(rowsInserted(QModelIndex, int, int)));
         disconnect(m_contactsModel, SIGNAL(rowsRemoved(QModelIndex, int, int)), this, SLOT(rowsRemoved(QModelIndex, int, int)));
 
-        delete m_contactsModel;
-        delete m_monitorAddressBook;
-        
+        if (m_contactsModel != m_injectedContactsModel) delete m_contactsModel;
+        else m_registeredCollectionId = -1;
         m_contactsModel = 0;
+    }
+
+    if (m_monitorAddressBook != 0) {
+        m_registeredCollectionId = -1;
+
+        // the recorder writes the unprocessed changes to the journal when deleted
+        delete m_monitorAddressBook;
         m_monitorAddressBook = 0;
+        m_replayInProgress = false;
     }
+
+    delete m_changeJournal;
+    m_changeJournal = 0;
+    setInitialSyncDone(false);
+
+    // the results of the running validation would belong to the old collection
+    foreach (KJob *job, m_cacheValidationJobs) job->kill(KJob::Quietly);
+    m_cacheValidationJobs.clear();
+    m_fetchedRevisions.clear();
+    m_cachedCollectionIds.clear();
+
+    m_contacts.clear();
+    m_itemUids.clear();
+    m_itemRevisions.clear();
 }
 
 void BirthdayList::Source_Akonadi::collectionsUpdated()
 {
+    SlotWatchdog watchdog("Source_Akonadi::collectionsUpdated");
     // synchronize this call with collection update (at startup or when changing the collection using config UI)
     m_collectionRegistrationMutex.lock();
     
@@ -132,37 +295,119 @@ void BirthdayList::Source_Akonadi::collectionsUpdated()
 
 void BirthdayList::Source_Akonadi::dataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight)
 {
-    if (isChangeDetected(topLeft, bottomRight)) {
-        kDebug() << "Akonadi EntityTreeModel data changed between" << topLeft.row() << "and" << bottomRight.row() << ", some contacts changed";
-        updateContacts();
-    }
-    else {
-        kDebug() << "Akonadi EntityTreeModel data changed between" << topLeft.row() << "and" << bottomRight.row() << ", no change in contacts detected";
+    SlotWatchdog watchdog("Source_Akonadi::dataChanged");
+    BL_TRACE_SPAN_ARGS(TC_Sources, "dataChanged", QString("\"first\": %1, \"last\": %2").arg(topLeft.row()).arg(bottomRight.row()));
+    recordChange(ChangeStreamEvent::CE_DataChanged, topLeft.parent(), topLeft.row(), bottomRight.row());
+
+    if (isSuspended() && isInitialSyncDone()) {
+        if (isRevisionChanged(topLeft, bottomRight)) {
+            m_ingestPending = true;
+            notifyContactsUpdated();
+        }
+        return;
     }
+
+    DiagnosticsTimer changeDetectionTimer("changeDetection");
+    bool changeDetected = isChangeDetected(topLeft, bottomRight);
+    changeDetectionTimer.stop();
+    Diagnostics::instance()->incrementCounter(changeDetected ? "detectedChanges" : "ignoredChanges");
+
+    BL_TRACE_EVENT(TC_Sources, "changeDetection", QString("\"changed\": %1").arg(changeDetected ? "true" : "false"));
+    if (changeDetected) updateContacts();
 }
 
 void BirthdayList::Source_Akonadi::rowsInserted(const QModelIndex& parent, int start, int end)
 {
-    kDebug() << "Akonadi EntityTreeModel rows inserted between" << start << "and" << end << " under parent" << parent.internalId();
+    SlotWatchdog watchdog("Source_Akonadi::rowsInserted");
+    BL_TRACE_SPAN_ARGS(TC_Sources, "rowsInserted", QString("\"first\": %1, \"last\": %2, \"parent\": %3").arg(start).arg(end).arg(parent.internalId()));
+    recordChange(ChangeStreamEvent::CE_RowsInserted, parent, start, end);
     updateContacts();
 }
 
 void BirthdayList::Source_Akonadi::rowsRemoved(const QModelIndex& parent, int start, int end)
 {
-    kDebug() << "Akonadi EntityTreeModel rows removed between" << start << "and" << end << " under parent" << parent.internalId();
+    SlotWatchdog watchdog("Source_Akonadi::rowsRemoved");
+    BL_TRACE_SPAN_ARGS(TC_Sources, "rowsRemoved", QString("\"first\": %1, \"last\": %2, \"parent\": %3").arg(start).arg(end).arg(parent.internalId()));
+    recordChange(ChangeStreamEvent::CE_RowsRemoved, parent, start, end);
     updateContacts();
 }
 
 void BirthdayList::Source_Akonadi::updateContacts() 
 {
-    kDebug() << "Update of the contact model triggered";
+    SlotWatchdog watchdog("Source_Akonadi::updateContacts");
+    // the contacts are read once on catch-up (except during the initial synchronization, see notifyContactsUpdated)
+    if (isSuspended() && isInitialSyncDone()) {
+        m_ingestPending = true;
+        notifyContactsUpdated();
+        return;
+    }
+
+    ingestContacts();
+    notifyContactsUpdated();
+}
+
+void BirthdayList::Source_Akonadi::collectionPopulated(Akonadi::Collection::Id collectionId)
+{
+    SlotWatchdog watchdog("Source_Akonadi::collectionPopulated");
+    if (collectionId != m_registeredCollectionId) return;
+
+    kDebug() << "Initial synchronization of Akonadi collection" << collectionId << "done";
+    setInitialSyncDone(true);
+}
+
+void BirthdayList::Source_Akonadi::contactsUpdatedTimeout()
+{
+    notifyContactsUpdated();
+}
+
+void BirthdayList::Source_Akonadi::catchUp()
+{
+    BL_TRACE_SPAN(TC_Sources, "catchUp");
+    if (m_ingestPending) ingestContacts();
+    Source_Contacts::catchUp();
+}
+
+void BirthdayList::Source_Akonadi::ingestContacts()
+{
+    BL_TRACE_SPAN(TC_Sources, "ingest");
+    DiagnosticsTimer ingestTimer("ingest");
     
     m_contacts.clear();
+    m_itemUids.clear();
+    m_itemRevisions.clear();
     dumpContactChildren(0, QModelIndex());
+    contactCacheChanged();
+    m_ingestPending = false;
     
-    kDebug() << "Read" << m_contacts.size() << "entries from the current Akonadi collection";
+    BL_TRACE_COUNTER(TC_Sources, "contacts", m_contacts.size());
+}
+
+void BirthdayList::Source_Akonadi::recordChange(ChangeStreamEvent::Type type, const QModelIndex &parent, int start, int end)
+{
+    if (m_changeStreamRecorder == 0) return;
+
+    ChangeStreamEvent event;
+    event.type = type;
+    event.parentLevel = 0;
+    for (QModelIndex ancestor = parent; ancestor.isValid(); ancestor = ancestor.parent()) ++event.parentLevel;
+    event.firstRow = start;
+    event.lastRow = end;
+
+    // the removed rows are not available anymore
+    if (type != ChangeStreamEvent::CE_RowsRemoved) {
+        for (int row=start; row<=end; ++row) {
+            Akonadi::Item item = m_contactsModel->index(row, 0, parent).data(Akonadi::EntityTreeModel::ItemRole).value<Akonadi::Item>();
+            if (item.hasPayload<KABC::Addressee>()) {
+                KABC::Addressee kabcAddressee = item.payload<KABC::Addressee>();
+                AddresseeInfo addresseeInfo;
+                fillAddresseeInfo(addresseeInfo, kabcAddressee);
+                event.rows.append(ContactFingerprint::fromContact(addresseeInfo, kabcAddressee.uid()));
+            }
+            else event.rows.append(ContactFingerprint());
+        }
+    }
 
-    emit contactsUpdated();
+    m_changeStreamRecorder->record(event);
 }
 
 void BirthdayList::Source_Akonadi::dumpContactChildren(int level, const QModelIndex &parent) 
@@ -172,13 +417,8 @@ void BirthdayList::Source_Akonadi::dumpContactChildren(int level, const QModelIn
         Akonadi::Item item = index.data(Akonadi::EntityTreeModel::ItemRole).value<Akonadi::Item>();
         
         if (item.hasPayload<KABC::Addressee>()) {
-            KABC::Addressee kabcAddressee = item.payload<KABC::Addressee>();
             //kDebug() << "Name" << kabcAddressee.name() << ", Birthday " << kabcAddressee.birthday() << ", parent col" << item.parentCollection().id();
-            AddresseeInfo addresseeInfo;
-
-            fillAddresseeInfo(addresseeInfo, kabcAddressee);
-            
-            m_contacts.insert(kabcAddressee.uid(), addresseeInfo);
+            storeContactItem(item);
         }
         
         if (m_contactsModel->hasChildren(index)) dumpContactChildren(level+1, index);
@@ -211,3 +451,319 @@ bool BirthdayList::Source_Akonadi::isChangeDetected(const QModelIndex& topLeft,
     
     return false;
 }
+
+bool BirthdayList::Source_Akonadi::isRevisionChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight) const
+{
+    if (topLeft.parent() != bottomRight.parent()) return true;
+
+    for (int row=topLeft.row(); row<=bottomRight.row(); ++row) {
+        Akonadi::Item item = topLeft.sibling(row, topLeft.column()).data(Akonadi::EntityTreeModel::ItemRole).value<Akonadi::Item>();
+        if (!item.isValid() || item.mimeType() != KABC::Addressee::mimeType()) continue;
+
+        QHash<Akonadi::Item::Id, int>::const_iterator revisionIt = m_itemRevisions.constFind(item.id());
+        if (revisionIt == m_itemRevisions.constEnd() || revisionIt.value() != item.revision()) return true;
+    }
+
+    return false;
+}
+
+bool BirthdayList::Source_Akonadi::storeContactItem(const Akonadi::Item &item)
+{
+    if (!item.hasPayload<KABC::Addressee>()) return false;
+
+    KABC::Addressee kabcAddressee = item.payload<KABC::Addressee>();
+    AddresseeInfo addresseeInfo;
+    fillAddresseeInfo(addresseeInfo, kabcAddressee);
+
+    // the uid of the contact may change in the item (e.g. after a conflict resolution)
+    QString oldUid = m_itemUids.value(item.id());
+    if (!oldUid.isEmpty() && oldUid != kabcAddressee.uid()) m_contacts.remove(oldUid);
+
+    m_itemUids.insert(item.id(), kabcAddressee.uid());
+    m_itemRevisions.insert(item.id(), item.revision());
+    contactCacheChanged();
+
+    QHash<QString, AddresseeInfo>::iterator contactIt = m_contacts.find(kabcAddressee.uid());
+    if (contactIt != m_contacts.end() && contactIt.value() == addresseeInfo && oldUid == kabcAddressee.uid()) return false;
+
+    m_contacts.insert(kabcAddressee.uid(), addresseeInfo);
+    return true;
+}
+
+void BirthdayList::Source_Akonadi::removeContactItem(Akonadi::Item::Id itemId)
+{
+    if (!m_itemUids.contains(itemId)) return;
+
+    m_contacts.remove(m_itemUids.take(itemId));
+    m_itemRevisions.remove(itemId);
+    contactCacheChanged();
+}
+
+void BirthdayList::Source_Akonadi::replayNextChange()
+{
+    // changesAdded() comes also while a replayed change is being processed, the journal slots continue the replay then
+    if (m_replayInProgress || m_monitorAddressBook == 0 || m_monitorAddressBook->isEmpty()) return;
+
+    // the journal slots may be called before replayNext() returns (and continue the replay);
+    // if the recorder has nothing to emit, nothingToReplay() ends the replay in the same way
+    m_replayInProgress = true;
+    m_monitorAddressBook->replayNext();
+}
+
+void BirthdayList::Source_Akonadi::journalChangeProcessed()
+{
+    m_replayInProgress = false;
+    // nothingToReplay() comes with an empty journal, there is no change to acknowledge then
+    if (m_monitorAddressBook == 0 || m_monitorAddressBook->isEmpty()) return;
+
+    m_monitorAddressBook->changeProcessed();
+    replayNextChange();
+}
+
+void BirthdayList::Source_Akonadi::journalItemAdded(const Akonadi::Item &item, const Akonadi::Collection &collection)
+{
+    Q_UNUSED(collection);
+
+    BL_TRACE_EVENT(TC_Sources, "journalItemAdded", QString("\"item\": %1").arg(item.id()));
+    if (storeContactItem(item)) m_contactsUpdatedTimer.start();
+
+    journalChangeProcessed();
+}
+
+void BirthdayList::Source_Akonadi::journalItemChanged(const Akonadi::Item &item, const QSet<QByteArray> &partIdentifiers)
+{
+    Q_UNUSED(partIdentifiers);
+
+    BL_TRACE_EVENT(TC_Sources, "journalItemChanged", QString("\"item\": %1").arg(item.id()));
+    if (storeContactItem(item)) m_contactsUpdatedTimer.start();
+
+    journalChangeProcessed();
+}
+
+void BirthdayList::Source_Akonadi::journalItemRemoved(const Akonadi::Item &item)
+{
+    BL_TRACE_EVENT(TC_Sources, "journalItemRemoved", QString("\"item\": %1").arg(item.id()));
+    if (m_itemUids.contains(item.id())) {
+        removeContactItem(item.id());
+        m_contactsUpdatedTimer.start();
+    }
+
+    journalChangeProcessed();
+}
+
+void BirthdayList::Source_Akonadi::journalItemMoved(const Akonadi::Item &item, const Akonadi::Collection &source, const Akonadi::Collection &destination)
+{
+    Q_UNUSED(source);
+
+    BL_TRACE_EVENT(TC_Sources, "journalItemMoved", QString("\"item\": %1").arg(item.id()));
+    if (m_cachedCollectionIds.contains(destination.id())) {
+        if (storeContactItem(item)) m_contactsUpdatedTimer.start();
+    }
+    else if (m_itemUids.contains(item.id())) {
+        removeContactItem(item.id());
+        m_contactsUpdatedTimer.start();
+    }
+
+    journalChangeProcessed();
+}
+
+void BirthdayList::Source_Akonadi::abortCacheValidation(const QString &errorString)
+{
+    kDebug() << "Cannot validate the contact cache:" << errorString;
+    foreach (KJob *job, m_cacheValidationJobs) job->kill(KJob::Quietly);
+    m_cacheValidationJobs.clear();
+    m_fetchedRevisions.clear();
+    setInitialSyncDone(true);
+}
+
+void BirthdayList::Source_Akonadi::subcollectionsFetched(KJob *job)
+{
+    m_cacheValidationJobs.removeOne(job);
+    if (job->error()) {
+        abortCacheValidation(job->errorString());
+        return;
+    }
+
+    Akonadi::CollectionFetchJob *subcollectionsJob = qobject_cast<Akonadi::CollectionFetchJob*>(job);
+    if (!subcollectionsJob) return;
+
+    Akonadi::Collection::List collections = subcollectionsJob->collections();
+    collections.prepend(Akonadi::Collection(m_registeredCollectionId));
+    foreach (const Akonadi::Collection &collection, collections) {
+        // the changes in the subcollections are recorded as well from now on
+        m_cachedCollectionIds.insert(collection.id());
+        if (m_monitorAddressBook != 0) m_monitorAddressBook->setCollectionMonitored(collection);
+
+        Akonadi::ItemFetchJob *revisionsJob = new Akonadi::ItemFetchJob(collection, session());
+        revisionsJob->fetchScope().fetchFullPayload(false);
+        revisionsJob->fetchScope().fetchAllAttributes(false);
+        connect(revisionsJob, SIGNAL(result(KJob*)), this, SLOT(itemRevisionsFetched(KJob*)));
+        m_cacheValidationJobs.append(revisionsJob);
+    }
+}
+
+void BirthdayList::Source_Akonadi::itemRevisionsFetched(KJob *job)
+{
+    m_cacheValidationJobs.removeOne(job);
+    if (job->error()) {
+        abortCacheValidation(job->errorString());
+        return;
+    }
+
+    Akonadi::ItemFetchJob *revisionsJob = qobject_cast<Akonadi::ItemFetchJob*>(job);
+    if (revisionsJob) m_fetchedRevisions += revisionsJob->items();
+    // the cache is validated when the revisions of all collections of the tree are known
+    if (!m_cacheValidationJobs.isEmpty()) return;
+
+    Akonadi::Item::List changedItems;
+    QSet<Akonadi::Item::Id> existingItems;
+    foreach (const Akonadi::Item &item, m_fetchedRevisions) {
+        // an item linked to several collections of the tree is listed more than once
+        if (item.mimeType() != KABC::Addressee::mimeType() || existingItems.contains(item.id())) continue;
+        existingItems.insert(item.id());
+
+        if (!m_itemRevisions.contains(item.id()) || m_itemRevisions.value(item.id()) != item.revision()) {
+            changedItems.append(item);
+        }
+    }
+
+    int removedItems = 0;
+    foreach (Akonadi::Item::Id itemId, m_itemUids.keys()) {
+        if (!existingItems.contains(itemId)) {
+            removeContactItem(itemId);
+            ++removedItems;
+        }
+    }
+
+    m_fetchedRevisions.clear();
+
+    kDebug() << "Contact cache validated," << changedItems.size() << "items changed and" << removedItems << "removed since the last session";
+
+    if (!changedItems.isEmpty()) {
+        Akonadi::ItemFetchJob *changedItemsJob = new Akonadi::ItemFetchJob(changedItems, session());
+        changedItemsJob->fetchScope().fetchFullPayload(true);
+        changedItemsJob->fetchScope().fetchAllAttributes(true);
+        connect(changedItemsJob, SIGNAL(result(KJob*)), this, SLOT(changedItemsFetched(KJob*)));
+    }
+    else {
+        setInitialSyncDone(true);
+        if (removedItems > 0) {
+            storeContactCache();
+            m_contactsUpdatedTimer.start();
+        }
+    }
+}
+
+void BirthdayList::Source_Akonadi::changedItemsFetched(KJob *job)
+{
+    setInitialSyncDone(true);
+    if (job->error()) {
+        kDebug() << "Cannot fetch the changed contacts:" << job->errorString();
+        return;
+    }
+
+    Akonadi::ItemFetchJob *changedItemsJob = qobject_cast<Akonadi::ItemFetchJob*>(job);
+    if (!changedItemsJob) return;
+
+    foreach (const Akonadi::Item &item, changedItemsJob->items()) {
+        storeContactItem(item);
+    }
+
+    storeContactCache();
+    m_contactsUpdatedTimer.start();
+}
+
+QString BirthdayList::Source_Akonadi::contactCachePath(Akonadi::Collection::Id collectionId) const
+{
+    return KStandardDirs::locateLocal("data", QString("birthdaylist/akonadicache/contacts_%1.cache").arg(collectionId));
+}
+
+QString BirthdayList::Source_Akonadi::changeJournalPath(Akonadi::Collection::Id collectionId) const
+{
+    return KStandardDirs::locateLocal("data", QString("birthdaylist/akonadicache/changes_%1.journal").arg(collectionId));
+}
+
+bool BirthdayList::Source_Akonadi::loadContactCache(Akonadi::Collection::Id collectionId)
+{
+    m_contacts.clear();
+    m_itemUids.clear();
+    m_itemRevisions.clear();
+    m_contactCacheDirty = false;
+
+    QFile cacheFile(contactCachePath(collectionId));
+    if (!cacheFile.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream stream(&cacheFile);
+    stream.setVersion(QDataStream::Qt_4_6);
+
+    quint32 magic;
+    qint32 version;
+    qint64 cachedCollectionId;
+    qint32 contactCount;
+    stream >> magic >> version >> cachedCollectionId >> contactCount;
+    if (magic != ContactCacheMagic || version != ContactCacheVersion || cachedCollectionId != collectionId) {
+        kDebug() << "Ignoring incompatible contact cache" << cacheFile.fileName();
+        return false;
+    }
+
+    for (int i=0; i<contactCount && stream.status() == QDataStream::Ok; ++i) {
+        qint64 itemId;
+        qint32 revision;
+        QString uid;
+        AddresseeInfo addresseeInfo;
+        stream >> itemId >> revision >> uid >> addresseeInfo;
+
+        m_itemUids.insert(itemId, uid);
+        m_itemRevisions.insert(itemId, revision);
+        m_contacts.insert(uid, addresseeInfo);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        kDebug() << "Contact cache" << cacheFile.fileName() << "is corrupted";
+        m_contacts.clear();
+        m_itemUids.clear();
+        m_itemRevisions.clear();
+        return false;
+    }
+
+    kDebug() << "Read" << m_contacts.size() << "contacts from the contact cache" << cacheFile.fileName();
+    return true;
+}
+
+void BirthdayList::Source_Akonadi::storeContactCache()
+{
+    // the contacts of an injected model don't belong to the Akonadi collection of the same id
+    if (m_registeredCollectionId < 0 || m_injectedContactsModel != 0) return;
+
+    QFile cacheFile(contactCachePath(m_registeredCollectionId));
+    if (!cacheFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        kDebug() << "Cannot write the contact cache" << cacheFile.fileName();
+        return;
+    }
+
+    QDataStream stream(&cacheFile);
+    stream.setVersion(QDataStream::Qt_4_6);
+    stream << ContactCacheMagic << ContactCacheVersion << qint64(m_registeredCollectionId) << qint32(m_itemUids.size());
+
+    QHashIterator<Akonadi::Item::Id, QString> itemIt(m_itemUids);
+    while (itemIt.hasNext()) {
+        itemIt.next();
+        stream << qint64(itemIt.key()) << qint32(m_itemRevisions.value(itemIt.key())) << itemIt.value() << m_contacts.value(itemIt.value());
+    }
+
+    m_contactCacheDirty = false;
+    m_storeContactCacheTimer.stop();
+    kDebug() << "Stored" << m_itemUids.size() << "contacts in the contact cache" << cacheFile.fileName();
+}
+
+void BirthdayList::Source_Akonadi::contactCacheChanged()
+{
+    m_contactCacheDirty = true;
+    if (m_injectedContactsModel == 0) m_storeContactCacheTimer.start();
+}
+
+void BirthdayList::Source_Akonadi::storeContactCacheTimeout()
+{
+    SlotWatchdog watchdog("Source_Akonadi::storeContactCacheTimeout");
+    if (m_contactCacheDirty) storeContactCache();
+}
@@ -19,9 +19,13 @@
  */
 
 
+#include "birthdaylist_changestream.h"
 #include "birthdaylist_source_contacts.h"
 #include <Akonadi/Collection>
+#include <Akonadi/Item>
 #include <QMutex>
+#include <QSet>
+#include <QTimer>
 
 namespace BirthdayList {
     class Source_Collections;
@@ -31,7 +35,10 @@ namespace Akonadi {
     class EntityTreeModel;
     class Session;
 };
+class KJob;
+class QAbstractItemModel;
 class QModelIndex;
+class QSettings;
 
 
 namespace BirthdayList 
@@ -46,14 +53,52 @@ namespace BirthdayList
         void setCurrentCollection(Akonadi::Collection::Id collectionId);
         
         virtual const QHash<QString, AddresseeInfo>& getAllContacts();
+        /** Adds the contacts, the item maps and the EntityTreeModel holding the items to the report */
+        virtual void accountMemory(MemoryReport &report);
+
+        /** Reads the contacts of the current collection from the given model instead of Akonadi
+        *  (the model is not owned; it must provide the items in the EntityTreeModel::ItemRole, see AkonadiStandIn) */
+        void setContactsModel(QAbstractItemModel *contactsModel);
+
+    protected:
+        /** Reads the contacts again if the contacts model changed while suspended */
+        virtual void catchUp();
 
     private:
+        /** Returns the Akonadi session (created when it is needed for the first time) */
+        Akonadi::Session *session();
+        /** Starts reading the contacts from the given model (the EntityTreeModel or the injected model) */
+        void connectContactsModel(QAbstractItemModel *contactsModel);
         void tryRegisteringInCurrentCollection();
         void registerInCollection(const Akonadi::Collection &akonadiCollection);
+        /** Fetches the complete collection into a new EntityTreeModel (used when no contact cache is available) */
+        void registerWithFullFetch(const Akonadi::Collection &akonadiCollection);
+        /** Starts from the persisted contact cache and only replays the changes recorded since the last session */
+        void registerWithContactCache(const Akonadi::Collection &akonadiCollection);
         void unregisterFromCurrentCollection();
 
+        /** Writes the signal of the contacts model to the change stream recording (if enabled) */
+        void recordChange(ChangeStreamEvent::Type type, const QModelIndex &parent, int start, int end);
+
         void dumpContactChildren(int level, const QModelIndex &parent);
         bool isChangeDetected(const QModelIndex& topLeft, const QModelIndex& bottomRight);
+        /** Cheap variant of isChangeDetected used while suspended: compares only the item revisions, not the payloads */
+        bool isRevisionChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight) const;
+        /** Reads all contacts from the contacts model */
+        void ingestContacts();
+
+        /** Stores the contact carried by the given item in the cache; returns true if the cached contact changed */
+        bool storeContactItem(const Akonadi::Item &item);
+        void removeContactItem(Akonadi::Item::Id itemId);
+
+        QString contactCachePath(Akonadi::Collection::Id collectionId) const;
+        QString changeJournalPath(Akonadi::Collection::Id collectionId) const;
+        bool loadContactCache(Akonadi::Collection::Id collectionId);
+        void storeContactCache();
+        /** Marks the contact cache as changed, it is written when no further change comes for a while */
+        void contactCacheChanged();
+        /** Stops the validation of the contact cache after a failed job, the cached contacts are kept */
+        void abortCacheValidation(const QString &errorString);
 
         const Source_Collections &m_sourceCollections;
         Akonadi::Session *m_session;
@@ -62,9 +107,38 @@ namespace BirthdayList
         Akonadi::Collection::Id m_currentCollectionId;
         Akonadi::Collection::Id m_registeredCollectionId;
         Akonadi::ChangeRecorder *m_monitorAddressBook;
-        Akonadi::EntityTreeModel *m_contactsModel;
+        QAbstractItemModel *m_contactsModel;
+        QAbstractItemModel *m_injectedContactsModel;
+        /** Persistent storage of the changes recorded by m_monitorAddressBook */
+        QSettings *m_changeJournal;
 
         QHash<QString, AddresseeInfo> m_contacts;
+        /** Contact uid and revision for each Akonadi item in m_contacts (used to validate the contact cache) */
+        QHash<Akonadi::Item::Id, QString> m_itemUids;
+        QHash<Akonadi::Item::Id, int> m_itemRevisions;
+        bool m_contactCacheDirty;
+        /** Delays writing the changed contact cache, so that a burst of changes writes it only once */
+        QTimer m_storeContactCacheTimer;
+        static const int m_storeContactCacheDelay = 5000;
+        /** The contacts model changed while suspended, the contacts have to be read again on catch-up */
+        bool m_ingestPending;
+
+        /** Diagnostics: records the signals of the contacts model (see BIRTHDAYLIST_RECORD_AKONADI) */
+        ChangeStreamRecorder *m_changeStreamRecorder;
+
+        /** Coalesces the notifications about the contacts changed by the replayed journal entries */
+        QTimer m_contactsUpdatedTimer;
+        /** A journal entry was replayed and is not processed yet; the recorder must not replay the next one meanwhile */
+        bool m_replayInProgress;
+        /** The registered collection and its subcollections (the same tree the full fetch reads) */
+        QSet<Akonadi::Collection::Id> m_cachedCollectionIds;
+        /** Running jobs of the contact cache validation and the item revisions fetched by the finished ones */
+        QList<KJob*> m_cacheValidationJobs;
+        Akonadi::Item::List m_fetchedRevisions;
+
+        /** Estimated heap of one item in the EntityTreeModel without its contact payload
+         *  (the tree node, Akonadi::Item and its private data, KABC::Addressee private data) */
+        static const int m_etmItemBytes = 768;
         
     private slots:
         void collectionsUpdated();
@@ -72,6 +146,22 @@ namespace BirthdayList
         void rowsInserted(const QModelIndex& parent, int start, int end);
         void rowsRemoved(const QModelIndex& parent, int start, int end);
         void updateContacts();
+        /** The initial synchronization of the entity tree model is done */
+        void collectionPopulated(Akonadi::Collection::Id collectionId);
+        void contactsUpdatedTimeout();
+        void storeContactCacheTimeout();
+
+        void replayNextChange();
+        void journalItemAdded(const Akonadi::Item &item, const Akonadi::Collection &collection);
+        void journalItemChanged(const Akonadi::Item &item, const QSet<QByteArray> &partIdentifiers);
+        void journalItemRemoved(const Akonadi::Item &item);
+        /** Stores the moved contact if it stays in the collection tree, removes it otherwise */
+        void journalItemMoved(const Akonadi::Item &item, const Akonadi::Collection &source, const Akonadi::Collection &destination);
+        /** Acknowledges the replayed journal entry (also the ones without a handler) and replays the next one */
+        void journalChangeProcessed();
+        void subcollectionsFetched(KJob *job);
+        void itemRevisionsFetched(KJob *job);
+        void changedItemsFetched(KJob *job);
     };
 };
 
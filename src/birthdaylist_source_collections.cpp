@@ -17,6 +17,8 @@
 
 
 #include "birthdaylist_source_collections.h"
+#include "birthdaylist_diagnostics.h"
+#include "birthdaylist_trace.h"
 #include <Akonadi/ChangeRecorder>
 #include <Akonadi/Collection>
 #include <Akonadi/CollectionModel>
@@ -35,14 +37,24 @@ BirthdayList::Source_Collections::Source_Collections()
     monitorCollections->setCollectionMonitored(Akonadi::Collection::root());
     monitorCollections->setMimeTypeMonitored(KABC::Addressee::mimeType());
 
-    m_collectionsModel = new Akonadi::EntityTreeModel(monitorCollections, this);
-    m_collectionsModel->setCollectionFetchStrategy(Akonadi::EntityTreeModel::FetchCollectionsRecursive);
-    m_collectionsModel->setItemPopulationStrategy(Akonadi::EntityTreeModel::NoItemPopulation);
+    Akonadi::EntityTreeModel *collectionsModel = new Akonadi::EntityTreeModel(monitorCollections, this);
+    collectionsModel->setCollectionFetchStrategy(Akonadi::EntityTreeModel::FetchCollectionsRecursive);
+    collectionsModel->setItemPopulationStrategy(Akonadi::EntityTreeModel::NoItemPopulation);
+    m_collectionsModel = collectionsModel;
     
     connect(m_collectionsModel, SIGNAL(rowsInserted(QModelIndex, int, int)), this, SLOT(updateCollectionsMap()));
     connect(m_collectionsModel, SIGNAL(dataChanged(QModelIndex,QModelIndex)), this, SLOT(updateCollectionsMap()));
 }
 
+BirthdayList::Source_Collections::Source_Collections(QAbstractItemModel *collectionsModel)
+: m_session(0),
+m_collectionsModel(collectionsModel)
+{
+    connect(m_collectionsModel, SIGNAL(rowsInserted(QModelIndex, int, int)), this, SLOT(updateCollectionsMap()));
+    connect(m_collectionsModel, SIGNAL(dataChanged(QModelIndex,QModelIndex)), this, SLOT(updateCollectionsMap()));
+    updateCollectionsMap();
+}
+
 BirthdayList::Source_Collections::~Source_Collections()
 {
 }
@@ -60,10 +72,12 @@ const Akonadi::Collection BirthdayList::Source_Collections::getAkonadiCollection
 
 void BirthdayList::Source_Collections::updateCollectionsMap()
 {
-    kDebug() << "Akonadi collections list updated";
+    SlotWatchdog watchdog("Source_Collections::updateCollectionsMap");
+    BL_TRACE_SPAN(TC_Sources, "updateCollectionsMap");
     m_collectionIds.clear();
     m_collections.clear();
     dumpCollectionChildren(0, QModelIndex());
+    if (!m_collections.isEmpty()) Diagnostics::instance()->recordMilestone("collectionsReady");
 
     emit collectionsUpdated();
 }
@@ -80,7 +94,7 @@ void BirthdayList::Source_Collections::dumpCollectionChildren(int level, const Q
                 collectionName.prepend(index.parent().data().toString());
             }
             
-            kDebug() << "Collection" << index.data().toString() << "(id:" << collection.id() << ", name:" << collection.name() << ", combobox entry:" << collectionName << ")";
+            BL_TRACE_EVENT(TC_Sources, "collection", QString("\"id\": %1, \"level\": %2").arg(collection.id()).arg(level));
             m_collectionIds.insert(collectionName, collection.id());
             m_collections.insert(collection.id(), collection);
 
@@ -26,6 +26,7 @@ namespace Akonadi {
     class EntityTreeModel;
     class Session;
 };
+class QAbstractItemModel;
 class QModelIndex;
 
 
@@ -36,6 +37,8 @@ namespace BirthdayList
         Q_OBJECT
     public:
         Source_Collections();
+        /** Reads the collections from the given model instead of Akonadi (the model is not owned; see AkonadiStandIn) */
+        explicit Source_Collections(QAbstractItemModel *collectionsModel);
         ~Source_Collections();
         
         QHash<QString, int> getAkonadiCollections() const;
@@ -45,7 +48,7 @@ namespace BirthdayList
         void dumpCollectionChildren(int level, const QModelIndex &parent);
 
         Akonadi::Session *m_session;
-        Akonadi::EntityTreeModel *m_collectionsModel;
+        QAbstractItemModel *m_collectionsModel;
 
         QHash<QString, int> m_collectionIds;
         QHash<Akonadi::Collection::Id, Akonadi::Collection> m_collections;
@@ -17,6 +17,8 @@
 
 
 #include "birthdaylist_source_contacts.h"
+#include "birthdaylist_diagnostics.h"
+#include "birthdaylist_memoryreport.h"
 #include <KABC/Addressee>
 #include <KDebug>
 
@@ -39,14 +41,102 @@ bool BirthdayList::AddresseeInfo::operator!=(const BirthdayList::AddresseeInfo&
     return !(*this == other);
 }
 
+QDataStream &BirthdayList::operator<<(QDataStream &stream, const BirthdayList::AddresseeInfo &addresseeInfo)
+{
+    stream << addresseeInfo.name << addresseeInfo.nickName << addresseeInfo.givenName
+           << addresseeInfo.email << addresseeInfo.homepage << addresseeInfo.birthday
+           << addresseeInfo.categories << addresseeInfo.customFields;
+    return stream;
+}
+
+QDataStream &BirthdayList::operator>>(QDataStream &stream, BirthdayList::AddresseeInfo &addresseeInfo)
+{
+    stream >> addresseeInfo.name >> addresseeInfo.nickName >> addresseeInfo.givenName
+           >> addresseeInfo.email >> addresseeInfo.homepage >> addresseeInfo.birthday
+           >> addresseeInfo.categories >> addresseeInfo.customFields;
+    return stream;
+}
+
 BirthdayList::Source_Contacts::Source_Contacts()
+: m_suspended(false),
+m_changedWhileSuspended(false),
+m_initialSyncDone(false)
 {
+    m_suspendedCatchUpTimer.setSingleShot(true);
+    m_suspendedCatchUpTimer.setInterval(m_suspendedCatchUpDelay);
+    connect(&m_suspendedCatchUpTimer, SIGNAL(timeout()), this, SLOT(suspendedCatchUpTimeout()));
 }
 
 BirthdayList::Source_Contacts::~Source_Contacts()
 {
 }
 
+void BirthdayList::Source_Contacts::accountMemory(MemoryReport &report)
+{
+    const QHash<QString, AddresseeInfo> &contacts = getAllContacts();
+    qint64 bytes = MemoryReport::hashBytes(contacts);
+    QHashIterator<QString, AddresseeInfo> contactIt(contacts);
+    while (contactIt.hasNext()) {
+        contactIt.next();
+        bytes += MemoryReport::stringBytes(contactIt.key()) + addresseeInfoBytes(contactIt.value());
+    }
+    report.add("contacts", bytes, contacts.size());
+}
+
+void BirthdayList::Source_Contacts::setSuspended(bool suspended)
+{
+    if (m_suspended == suspended) return;
+    m_suspended = suspended;
+
+    if (!suspended) {
+        m_suspendedCatchUpTimer.stop();
+        if (m_changedWhileSuspended) catchUp();
+    }
+}
+
+void BirthdayList::Source_Contacts::notifyContactsUpdated()
+{
+    // the panel summary has to be computed from the complete contact list
+    if (m_suspended && m_initialSyncDone) {
+        Diagnostics::instance()->incrementCounter("suspendedChanges");
+        m_changedWhileSuspended = true;
+        // no wakeups while nothing changes, at most one catch-up per delay while the contacts keep changing
+        if (!m_suspendedCatchUpTimer.isActive()) m_suspendedCatchUpTimer.start();
+        return;
+    }
+
+    m_changedWhileSuspended = false;
+    emit contactsUpdated();
+}
+
+void BirthdayList::Source_Contacts::catchUp()
+{
+    m_suspendedCatchUpTimer.stop();
+    m_changedWhileSuspended = false;
+    emit contactsUpdated();
+}
+
+void BirthdayList::Source_Contacts::suspendedCatchUpTimeout()
+{
+    SlotWatchdog watchdog("Source_Contacts::suspendedCatchUpTimeout");
+    if (m_changedWhileSuspended) catchUp();
+}
+
+qint64 BirthdayList::Source_Contacts::addresseeInfoBytes(const AddresseeInfo &addresseeInfo)
+{
+    qint64 bytes = MemoryReport::stringBytes(addresseeInfo.name) + MemoryReport::stringBytes(addresseeInfo.nickName) +
+        MemoryReport::stringBytes(addresseeInfo.givenName) + MemoryReport::stringBytes(addresseeInfo.email) +
+        MemoryReport::stringBytes(addresseeInfo.homepage) + MemoryReport::stringListBytes(addresseeInfo.categories) +
+        MemoryReport::hashBytes(addresseeInfo.customFields);
+
+    QHashIterator<QString, QVariant> fieldIt(addresseeInfo.customFields);
+    while (fieldIt.hasNext()) {
+        fieldIt.next();
+        bytes += MemoryReport::stringBytes(fieldIt.key()) + MemoryReport::variantBytes(fieldIt.value());
+    }
+    return bytes;
+}
+
 void BirthdayList::Source_Contacts::fillAddresseeInfo(BirthdayList::AddresseeInfo &addresseeInfo, const KABC::Addressee &kabcAddressee)
 {
     addresseeInfo.name = kabcAddressee.formattedName();
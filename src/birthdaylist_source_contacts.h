@@ -19,9 +19,11 @@
  */
 
 
+#include <QDataStream>
 #include <QDate>
 #include <QHash>
 #include <QStringList>
+#include <QTimer>
 #include <QVariant>
 
 namespace KABC {
@@ -31,6 +33,8 @@ namespace KABC {
 
 namespace BirthdayList 
 {
+    class MemoryReport;
+
     struct AddresseeInfo 
     {
         QString name;
@@ -46,6 +50,10 @@ namespace BirthdayList
         bool operator!=(const AddresseeInfo &other) const;
     };
 
+    /** Serialization of the contact information (used for the persistent contact caches) */
+    QDataStream &operator<<(QDataStream &stream, const AddresseeInfo &addresseeInfo);
+    QDataStream &operator>>(QDataStream &stream, AddresseeInfo &addresseeInfo);
+
 
     class Source_Contacts : public QObject
     {
@@ -55,9 +63,44 @@ namespace BirthdayList
         virtual ~Source_Contacts();
 
         virtual const QHash<QString, AddresseeInfo>& getAllContacts() = 0;
+
+        /** Adds the estimated heap used by the source to the report (the contacts by default) */
+        virtual void accountMemory(MemoryReport &report);
+        /** Returns the estimated heap used by the strings, categories and custom fields of the contact */
+        static qint64 addresseeInfoBytes(const AddresseeInfo &addresseeInfo);
+
+        /** While suspended, the changes of the contacts are only marked and contactsUpdated is emitted once when
+         *  the source is resumed, or m_suspendedCatchUpDelay after the first marked change, so that the panel summary
+         *  doesn't get too old; until the initial synchronization is done, the changes are delivered anyway */
+        void setSuspended(bool suspended);
+        bool isSuspended() const {
+            return m_suspended;
+        }
         
     protected:
         void fillAddresseeInfo(AddresseeInfo &addresseeInfo, const KABC::Addressee &kabcAddressee);
+        /** Emits contactsUpdated, or only marks the change while suspended after the initial synchronization */
+        void notifyContactsUpdated();
+        /** Marks whether the source has read all contacts of its backend since it was connected to it */
+        void setInitialSyncDone(bool initialSyncDone) {
+            m_initialSyncDone = initialSyncDone;
+        }
+        bool isInitialSyncDone() const {
+            return m_initialSyncDone;
+        }
+        /** Brings the contacts up to date after the changes marked while suspended and emits contactsUpdated */
+        virtual void catchUp();
+
+    private:
+        bool m_suspended;
+        bool m_changedWhileSuspended;
+        bool m_initialSyncDone;
+        /** Started by the first change marked while suspended, bounds the age of the panel summary */
+        QTimer m_suspendedCatchUpTimer;
+        static const int m_suspendedCatchUpDelay = 5 * 60 * 1000;
+
+    private slots:
+        void suspendedCatchUpTimeout();
         
     signals:
         void contactsUpdated();
@@ -0,0 +1,111 @@
+/**
+ * @file    birthdaylist_trace.cpp
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_trace.h"
+#include <KDebug>
+#include <QCoreApplication>
+#include <QStringList>
+
+
+int BirthdayList::Trace::m_enabledCategories = 0;
+
+
+BirthdayList::Trace::Trace()
+: m_pid(QCoreApplication::applicationPid())
+{
+    m_clock.start();
+}
+
+BirthdayList::Trace::~Trace()
+{
+    // the trace viewers accept an unterminated array, but close it properly if possible
+    if (m_file.isOpen()) m_file.write("{}\n]\n");
+    m_enabledCategories = 0;
+}
+
+BirthdayList::Trace *BirthdayList::Trace::instance()
+{
+    static Trace trace;
+    return &trace;
+}
+
+void BirthdayList::Trace::start(const QString &fileName, int categories)
+{
+    Trace *trace = instance();
+    if (trace->m_file.isOpen()) return;
+
+    trace->m_file.setFileName(fileName);
+    if (!trace->m_file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        kWarning() << "Cannot write the trace to" << fileName;
+        return;
+    }
+
+    kDebug() << "Writing the trace to" << fileName;
+    trace->m_file.write("[\n");
+    m_enabledCategories = categories;
+}
+
+int BirthdayList::Trace::parseCategories(const QString &categoryNames)
+{
+    int categories = 0;
+    foreach (const QString &categoryName, categoryNames.toLower().split(',', QString::SkipEmptyParts)) {
+        QString name = categoryName.trimmed();
+        if (name == "applet") categories |= TC_Applet;
+        else if (name == "model") categories |= TC_Model;
+        else if (name == "sources") categories |= TC_Sources;
+        else if (name == "view") categories |= TC_View;
+        else if (name == "all") categories |= TC_All;
+        else kWarning() << "Unknown trace category" << name;
+    }
+    return categories;
+}
+
+const char *BirthdayList::Trace::categoryName(int category)
+{
+    switch (category) {
+    case TC_Applet: return "applet";
+    case TC_Model: return "model";
+    case TC_Sources: return "sources";
+    case TC_View: return "view";
+    default: return "birthdaylist";
+    }
+}
+
+void BirthdayList::Trace::writeComplete(int category, const char *name, qint64 start, qint64 duration, const QString &args)
+{
+    writeEvent(category, name, 'X', start, QString("\"dur\": %1, \"args\": {%2}").arg(duration).arg(args));
+}
+
+void BirthdayList::Trace::writeInstant(int category, const char *name, const QString &args)
+{
+    writeEvent(category, name, 'i', timestamp(), QString("\"s\": \"t\", \"args\": {%1}").arg(args));
+}
+
+void BirthdayList::Trace::writeCounter(int category, const char *name, qint64 value)
+{
+    writeEvent(category, name, 'C', timestamp(), QString("\"args\": {\"value\": %1}").arg(value));
+}
+
+void BirthdayList::Trace::writeEvent(int category, const char *name, char phase, qint64 timestamp, const QString &fields)
+{
+    if (!m_file.isOpen()) return;
+
+    QString event = QString("{\"name\": \"%1\", \"cat\": \"%2\", \"ph\": \"%3\", \"ts\": %4, \"pid\": %5, \"tid\": 1, %6},\n")
+            .arg(name).arg(categoryName(category)).arg(phase).arg(timestamp).arg(m_pid).arg(fields);
+    m_file.write(event.toUtf8());
+}
@@ -0,0 +1,129 @@
+#ifndef BIRTHDAYLIST_TRACE_H
+#define BIRTHDAYLIST_TRACE_H
+
+/**
+ * @file    birthdaylist_trace.h
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+
+
+namespace BirthdayList 
+{
+    /**
+    * Writes trace events in the Chrome trace event format (can be opened in chrome://tracing or Perfetto).
+    * The tracing is compiled in only if BIRTHDAYLIST_TRACING is defined (see the CMake option of the same name)
+    * and is enabled at runtime for the selected categories (see BIRTHDAYLIST_TRACE in Applet::init).
+    * Use the BL_TRACE_* macros, they don't evaluate their arguments when the category is disabled.
+    */
+    class Trace
+    {
+    public:
+        enum Category { TC_Applet = 0x01, TC_Model = 0x02, TC_Sources = 0x04, TC_View = 0x08, TC_All = 0xff };
+
+        static bool isEnabled(int category) {
+            return (m_enabledCategories & category) != 0;
+        }
+
+        /** Starts writing the events of the given categories to the given file */
+        static void start(const QString &fileName, int categories);
+        /** Parses a comma separated list of category names (applet, model, sources, view, all) */
+        static int parseCategories(const QString &categoryNames);
+
+        static Trace *instance();
+        ~Trace();
+
+        /** Returns the time since the start of the trace in microseconds */
+        qint64 timestamp() const {
+            return m_clock.nsecsElapsed() / 1000;
+        }
+
+        /** Writes a span; the arguments are the members of a JSON object (e.g. "\"rows\": 5") */
+        void writeComplete(int category, const char *name, qint64 start, qint64 duration, const QString &args = QString());
+        void writeInstant(int category, const char *name, const QString &args = QString());
+        void writeCounter(int category, const char *name, qint64 value);
+
+    private:
+        Trace();
+        void writeEvent(int category, const char *name, char phase, qint64 timestamp, const QString &fields);
+        static const char *categoryName(int category);
+
+        QFile m_file;
+        QElapsedTimer m_clock;
+        qint64 m_pid;
+        static int m_enabledCategories;
+    };
+
+
+    /**
+    * Traces the time from its construction to its destruction as one span.
+    */
+    class TraceSpan
+    {
+    public:
+        TraceSpan(int category, const char *name) 
+        : m_category(Trace::isEnabled(category) ? category : 0), m_name(name), m_start(0) {
+            if (m_category) m_start = Trace::instance()->timestamp();
+        }
+
+        ~TraceSpan() {
+            if (m_category) Trace::instance()->writeComplete(m_category, m_name, m_start, Trace::instance()->timestamp() - m_start, m_args);
+        }
+
+        bool isEnabled() const {
+            return m_category != 0;
+        }
+        /** Sets the arguments shown with the span (see Trace::writeComplete) */
+        void setArgs(const QString &args) {
+            m_args = args;
+        }
+
+    private:
+        int m_category;
+        const char *m_name;
+        qint64 m_start;
+        QString m_args;
+    };
+};
+
+
+#define BL_TRACE_CONCAT_(a, b) a##b
+#define BL_TRACE_CONCAT(a, b) BL_TRACE_CONCAT_(a, b)
+
+#ifdef BIRTHDAYLIST_TRACING
+/** Traces the rest of the enclosing scope as a span */
+#define BL_TRACE_SPAN(category, name) \
+    BirthdayList::TraceSpan BL_TRACE_CONCAT(traceSpan, __LINE__)(BirthdayList::Trace::category, name)
+/** Traces the rest of the enclosing scope as a span with arguments (evaluated at the start of the span) */
+#define BL_TRACE_SPAN_ARGS(category, name, args) \
+    BirthdayList::TraceSpan BL_TRACE_CONCAT(traceSpan, __LINE__)(BirthdayList::Trace::category, name); \
+    if (BL_TRACE_CONCAT(traceSpan, __LINE__).isEnabled()) BL_TRACE_CONCAT(traceSpan, __LINE__).setArgs(args)
+#define BL_TRACE_EVENT(category, name, args) \
+    do { if (BirthdayList::Trace::isEnabled(BirthdayList::Trace::category)) BirthdayList::Trace::instance()->writeInstant(BirthdayList::Trace::category, name, args); } while (0)
+#define BL_TRACE_COUNTER(category, name, value) \
+    do { if (BirthdayList::Trace::isEnabled(BirthdayList::Trace::category)) BirthdayList::Trace::instance()->writeCounter(BirthdayList::Trace::category, name, value); } while (0)
+#else
+#define BL_TRACE_SPAN(category, name) do {} while (0)
+#define BL_TRACE_SPAN_ARGS(category, name, args) do {} while (0)
+#define BL_TRACE_EVENT(category, name, args) do {} while (0)
+#define BL_TRACE_COUNTER(category, name, value) do {} while (0)
+#endif
+
+
+#endif //BIRTHDAYLIST_TRACE_H
@@ -16,14 +16,22 @@
  */
 
 #include "birthdaylist_view.h"
+#include "birthdaylist_cacheditemdelegate.h"
+#include "birthdaylist_diagnostics.h"
 #include "birthdaylist_model.h"
+#include "birthdaylist_modelentry.h"
+#include "birthdaylist_trace.h"
 #include <Plasma/Theme>
 #include <Plasma/TreeView>
 #include <KIcon>
 #include <KMimeTypeTrader>
 #include <KToolInvocation>
 #include <QAction>
+#include <QEvent>
+#include <QFontMetrics>
 #include <QHeaderView>
+#include <QStyle>
+#include <QTimer>
 #include <QTreeView>
 
 
@@ -40,14 +48,20 @@ columnWidthWhen(0),
 visualIndexName(-1),
 visualIndexAge(-1),
 visualIndexDate(-1),
-visualIndexWhen(-1)
+visualIndexWhen(-1),
+sortColumn(3),
+sortOrder(Qt::AscendingOrder)
 {
 }
 
 
 BirthdayList::View::View(Model *model, QGraphicsWidget *parent)
 : Plasma::TreeView(parent),
-m_model(model)
+m_model(model),
+m_itemDelegate(new CachedItemDelegate(this)),
+m_restoreFirstRow(-1),
+m_restoreLastRow(-1),
+m_autoColumnWidths(4, -1)
 {
     setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
     QTreeView *treeView = nativeWidget();
@@ -55,24 +69,52 @@ m_model(model)
     treeView->setAnimated(true);
     treeView->setAllColumnsShowFocus(true);
     treeView->setRootIsDecorated(false);
-    //treeView->setSortingEnabled(true);
+    // the model sorts its entries itself; the default order (by the remaining days) is the one of the When column
+    treeView->header()->setSortIndicator(3, Qt::AscendingOrder);
     treeView->setSelectionMode(QAbstractItemView::NoSelection);
     treeView->setSelectionBehavior(QAbstractItemView::SelectRows);
     treeView->setItemsExpandable(true);
     treeView->setExpandsOnDoubleClick(true);
+    treeView->setItemDelegate(m_itemDelegate);
+    // all rows have the same height, so the layout doesn't ask the delegate for the size of every row
+    treeView->setUniformRowHeights(true);
     
     setModel(m_model);
+    treeView->setSortingEnabled(true);
     setMinimumHeight(10);
     
     connect(Plasma::Theme::defaultTheme(), SIGNAL(themeChanged()), this, SLOT(plasmaThemeChanged()));
     connect(nativeWidget()->header(), SIGNAL(sectionResized(int,int,int)), this, SLOT(columnsResized(int,int,int)));
     connect(nativeWidget()->header(), SIGNAL(sectionMoved(int,int,int)), this, SLOT(columnsMoved(int,int,int)));
+    connect(nativeWidget()->header(), SIGNAL(sortIndicatorChanged(int,Qt::SortOrder)), this, SLOT(sortingChanged(int,Qt::SortOrder)));
+    connect(treeView, SIGNAL(expanded(QModelIndex)), this, SLOT(entryExpanded(QModelIndex)));
+    connect(treeView, SIGNAL(collapsed(QModelIndex)), this, SLOT(entryCollapsed(QModelIndex)));
+    connect(m_model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(modelRowsInserted(QModelIndex,int,int)));
+    connect(m_model, SIGNAL(eventsUpdated()), this, SLOT(eventsUpdated()));
+    // the cached rows are identified by their position, so they get outdated when the rows or the columns change
+    connect(m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex)), m_itemDelegate, SLOT(invalidate()));
+    connect(m_model, SIGNAL(modelReset()), m_itemDelegate, SLOT(invalidate()));
+    connect(m_model, SIGNAL(layoutChanged()), m_itemDelegate, SLOT(invalidate()));
+    connect(m_model, SIGNAL(rowsInserted(QModelIndex,int,int)), m_itemDelegate, SLOT(rowsInserted(QModelIndex,int,int)));
+    connect(m_model, SIGNAL(rowsRemoved(QModelIndex,int,int)), m_itemDelegate, SLOT(invalidate()));
+    connect(treeView->header(), SIGNAL(sectionResized(int,int,int)), m_itemDelegate, SLOT(invalidate()));
+    connect(treeView->header(), SIGNAL(sectionMoved(int,int,int)), m_itemDelegate, SLOT(invalidate()));
+    // the column drags end on the header viewport
+    treeView->header()->viewport()->installEventFilter(this);
 }
 
 BirthdayList::View::~View()
 {
 }
 
+bool BirthdayList::View::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::MouseButtonRelease && watched == nativeWidget()->header()->viewport()) {
+        emit settingsChangeFinished();
+    }
+    return Plasma::TreeView::eventFilter(watched, event);
+}
+
 void BirthdayList::View::setConfiguration(ViewConfiguration newConf) 
 {
     m_conf = newConf;
@@ -129,10 +171,13 @@ QString BirthdayList::View::getSelectedLineItem(int column)
 
 void BirthdayList::View::setColumnSettings() 
 {
+    BL_TRACE_SPAN(TC_View, "viewLayout");
+    DiagnosticsTimer layoutTimer("viewLayout");
     QTreeView *qTreeView = nativeWidget();
 
     disconnect(nativeWidget()->header(), SIGNAL(sectionMoved(int,int,int)), this, SLOT(columnsMoved(int,int,int)));
     disconnect(nativeWidget()->header(), SIGNAL(sectionResized(int,int,int)), this, SLOT(columnsResized(int,int,int)));
+    disconnect(nativeWidget()->header(), SIGNAL(sortIndicatorChanged(int,Qt::SortOrder)), this, SLOT(sortingChanged(int,Qt::SortOrder)));
 
     qTreeView->setHeaderHidden(!m_conf.showColumnHeaders);
     qTreeView->setColumnHidden(0, !m_conf.showColName);
@@ -157,24 +202,88 @@ void BirthdayList::View::setColumnSettings()
     if (m_conf.visualIndexDate >= 0) header->moveSection(header->visualIndex(2), m_conf.visualIndexDate);
     if (m_conf.visualIndexWhen >= 0) header->moveSection(header->visualIndex(3), m_conf.visualIndexWhen);
 
-    if (m_conf.columnWidthName < 10) qTreeView->resizeColumnToContents(0);
-    else qTreeView->setColumnWidth(0, m_conf.columnWidthName);
+    // changing the sort indicator makes the tree view sort the model
+    if (m_conf.sortColumn >= 0 && m_conf.sortColumn < 4) header->setSortIndicator(m_conf.sortColumn, m_conf.sortOrder);
 
-    if (m_conf.columnWidthAge  < 10) qTreeView->resizeColumnToContents(1);
-    else qTreeView->setColumnWidth(1, m_conf.columnWidthAge);
-
-    if (m_conf.columnWidthDate < 10) qTreeView->resizeColumnToContents(2);
-    else qTreeView->setColumnWidth(2, m_conf.columnWidthDate);
-
-    if (m_conf.columnWidthWhen < 10) qTreeView->resizeColumnToContents(3);
-    else qTreeView->setColumnWidth(3, m_conf.columnWidthWhen);
+    qTreeView->setColumnWidth(0, m_conf.columnWidthName < 10 ? autoColumnWidth(0) : m_conf.columnWidthName);
+    qTreeView->setColumnWidth(1, m_conf.columnWidthAge  < 10 ? autoColumnWidth(1) : m_conf.columnWidthAge);
+    qTreeView->setColumnWidth(2, m_conf.columnWidthDate < 10 ? autoColumnWidth(2) : m_conf.columnWidthDate);
+    qTreeView->setColumnWidth(3, m_conf.columnWidthWhen < 10 ? autoColumnWidth(3) : m_conf.columnWidthWhen);
     
     connect(nativeWidget()->header(), SIGNAL(sectionResized(int,int,int)), this, SLOT(columnsResized(int,int,int)));
     connect(nativeWidget()->header(), SIGNAL(sectionMoved(int,int,int)), this, SLOT(columnsMoved(int,int,int)));
+    connect(nativeWidget()->header(), SIGNAL(sortIndicatorChanged(int,Qt::SortOrder)), this, SLOT(sortingChanged(int,Qt::SortOrder)));
+}
+
+int BirthdayList::View::autoColumnWidth(int column)
+{
+    QTreeView *qTreeView = nativeWidget();
+    ModelConfiguration modelConf = m_model->getConfiguration();
+    QString widthKey = QString("%1|%2|%3|%4").arg(modelConf.dateFormat).arg(modelConf.eventThreshold)
+        .arg(modelConf.pastThreshold).arg(qTreeView->font().key());
+    if (widthKey != m_autoColumnWidthKey) {
+        m_autoColumnWidthKey = widthKey;
+        m_autoColumnWidths.fill(-1);
+    }
+    if (m_autoColumnWidths[column] >= 0) return m_autoColumnWidths[column];
+
+    QFontMetrics fontMetrics(qTreeView->font());
+    int width = 0;
+
+    if (column == 0 || column == 1) {
+        foreach (const AbstractAnnualEventEntry *entry, m_model->sampleVisibleEntries(m_columnWidthSampleSize)) {
+            if (column == 0) width = qMax(width, cellWidth(fontMetrics, entry->name(), true));
+            else width = qMax(width, cellWidth(fontMetrics, QString::number(entry->age()), false));
+        }
+        // the stored nameday entries are shown indented under their aggregated entry
+        if (column == 0) width += qTreeView->indentation();
+    }
+    else if (column == 2) {
+        // a week in every month covers all names of the months and days
+        for (int month=1; month<=12; ++month) {
+            for (int day=22; day<=28; ++day) {
+                width = qMax(width, cellWidth(fontMetrics, QDate(2000, month, day).toString(modelConf.dateFormat), false));
+            }
+        }
+    }
+    else if (column == 3) {
+        // the special texts near today and the longest numbers of days in the past and in the future
+        QList<int> remainingDays;
+        remainingDays << -2 << -1 << 0 << 1 << 2 << 3 << -3 << -modelConf.pastThreshold << modelConf.eventThreshold;
+        foreach (int days, remainingDays) {
+            if (days < -modelConf.pastThreshold || days > modelConf.eventThreshold) continue;
+            width = qMax(width, cellWidth(fontMetrics, AbstractAnnualEventEntry::remainingDaysString(days), false));
+        }
+    }
+
+    width = qMax(width, qTreeView->header()->sectionSizeHint(column));
+    m_autoColumnWidths[column] = width;
+    return width;
+}
+
+int BirthdayList::View::cellWidth(const QFontMetrics &fontMetrics, const QString &text, bool hasIcon) const
+{
+    QTreeView *qTreeView = nativeWidget();
+    // the item delegates keep a margin of the focus frame and one pixel on both sides of the text and the icon
+    int margin = qTreeView->style()->pixelMetric(QStyle::PM_FocusFrameHMargin, 0, qTreeView) + 1;
+    int width = fontMetrics.width(text) + 2 * margin;
+    if (hasIcon) {
+        int iconWidth = qTreeView->iconSize().isValid() ? qTreeView->iconSize().width() :
+            qTreeView->style()->pixelMetric(QStyle::PM_SmallIconSize, 0, qTreeView);
+        width += iconWidth + 2 * margin;
+    }
+    return width;
+}
+
+void BirthdayList::View::eventsUpdated()
+{
+    m_autoColumnWidths[0] = -1;
+    m_autoColumnWidths[1] = -1;
 }
 
 void BirthdayList::View::plasmaThemeChanged() 
 {
+    SlotWatchdog watchdog("View::plasmaThemeChanged");
     usePlasmaThemeColors();
 }
     
@@ -202,6 +311,8 @@ void BirthdayList::View::usePlasmaThemeColors()
 
     nativeWidget()->setPalette(p);
     nativeWidget()->header()->setPalette(p);
+    // the icons of the theme may have changed as well, not only the palette
+    m_itemDelegate->invalidate();
 
     QBrush textBrush = QBrush(Plasma::Theme::defaultTheme()->color(Plasma::Theme::TextColor));
     for (int i = 0; i < m_model->columnCount(); ++i) {
@@ -246,6 +357,60 @@ void BirthdayList::View::columnsMoved(int logicalIndex, int oldVisualIndex, int
     emit settingsChanged();
 }
 
+void BirthdayList::View::sortingChanged(int logicalIndex, Qt::SortOrder order)
+{
+    m_conf.sortColumn = logicalIndex;
+    m_conf.sortOrder = order;
+
+    emit settingsChanged();
+}
+
+void BirthdayList::View::entryExpanded(const QModelIndex &index)
+{
+    QString entryKey = index.data(Model::EventKeyRole).toString();
+    if (!entryKey.isEmpty()) m_expandedEntryKeys.insert(entryKey);
+}
+
+void BirthdayList::View::entryCollapsed(const QModelIndex &index)
+{
+    m_expandedEntryKeys.remove(index.data(Model::EventKeyRole).toString());
+}
+
+void BirthdayList::View::modelRowsInserted(const QModelIndex &parent, int start, int end)
+{
+    if (parent.isValid() || m_expandedEntryKeys.isEmpty()) return;
+
+    // the children of the restored entries must not be created while the view is still inserting the rows,
+    // so the rows are expanded later (QModelIndex cannot be passed through a queued connection)
+    if (m_restoreFirstRow < 0) {
+        m_restoreFirstRow = start;
+        m_restoreLastRow = end;
+        QTimer::singleShot(0, this, SLOT(restoreExpandedEntries()));
+    }
+    else {
+        // the rows inserted before the already remembered ones shift them
+        if (start <= m_restoreLastRow) m_restoreLastRow += end - start + 1;
+        m_restoreFirstRow = qMin(m_restoreFirstRow, start);
+        m_restoreLastRow = qMax(m_restoreLastRow, end);
+    }
+}
+
+void BirthdayList::View::restoreExpandedEntries()
+{
+    int start = m_restoreFirstRow;
+    int end = m_restoreLastRow;
+    m_restoreFirstRow = -1;
+    m_restoreLastRow = -1;
+    if (start < 0) return;
+
+    for (int row = start; row <= end && row < m_model->rowCount(); ++row) {
+        QModelIndex index = m_model->index(row, 0);
+        if (m_expandedEntryKeys.contains(index.data(Model::EventKeyRole).toString())) {
+            nativeWidget()->expand(index);
+        }
+    }
+}
+
 void BirthdayList::View::sendEmail() 
 {
   KToolInvocation::invokeMailer(getSelectedLineItem(4), "");
@@ -20,12 +20,17 @@
 
 
 #include <Plasma/TreeView>
+#include <QSet>
+#include <QVector>
 #include "birthdaylist_aboutdata.h"
 
 namespace BirthdayList {
+    class CachedItemDelegate;
     class Model;
 };
+class QFontMetrics;
 class QGraphicsWidget;
+class QModelIndex;
 
 
 namespace BirthdayList
@@ -47,6 +52,8 @@ namespace BirthdayList
         int visualIndexAge;
         int visualIndexDate;
         int visualIndexWhen;
+        int sortColumn;
+        Qt::SortOrder sortOrder;
     };
 
 
@@ -68,19 +75,54 @@ namespace BirthdayList
 
     signals:
         void settingsChanged();
+        /** Emitted when the user releases the header after resizing or moving the columns */
+        void settingsChangeFinished();
+
+    protected:
+        virtual bool eventFilter(QObject *watched, QEvent *event);
         
     private:
         ViewConfiguration m_conf;
     
         Model *m_model;
+        /** Paints the cells from cached pixmaps (owned by the view) */
+        CachedItemDelegate *m_itemDelegate;
+
+        /** Keys of the expanded entries (used to restore the expansion after the model is refreshed) */
+        QSet<QString> m_expandedEntryKeys;
+        /** Top-level rows inserted since the last restoreExpandedEntries (-1 if there are none) */
+        int m_restoreFirstRow;
+        int m_restoreLastRow;
 
         QString getSelectedLineItem(int column);
 
+        /** Returns the width of the column fitting its content; unlike resizeColumnToContents it measures only
+         *  a sample of the names and ages and the longest possible dates and remaining days */
+        int autoColumnWidth(int column);
+        /** Returns the width of a cell showing the given text */
+        int cellWidth(const QFontMetrics &fontMetrics, const QString &text, bool hasIcon) const;
+
+        /** Widths of the first four columns estimated by autoColumnWidth (-1 if not estimated yet) */
+        QVector<int> m_autoColumnWidths;
+        /** Date format, thresholds and font, for which the widths of the date and remaining days were estimated */
+        QString m_autoColumnWidthKey;
+        /** Number of the entries measured to estimate the width of the name and age columns */
+        static const int m_columnWidthSampleSize = 64;
+
     private slots:
+        /** Forgets the estimated widths of the name and age columns when the events change */
+        void eventsUpdated();
         /** Receives a notification when the system plasma theme is changed. */
         void plasmaThemeChanged();
         void columnsResized(int logicalIndex, int oldSize, int newSize);
         void columnsMoved(int logicalIndex, int oldVisualIndex, int newVisualIndex);
+        void sortingChanged(int logicalIndex, Qt::SortOrder order);
+        void entryExpanded(const QModelIndex &index);
+        void entryCollapsed(const QModelIndex &index);
+        /** Remembers the inserted rows, they are checked by restoreExpandedEntries when the insertion is over */
+        void modelRowsInserted(const QModelIndex &parent, int start, int end);
+        /** Expands the newly inserted rows that were expanded before the model was refreshed */
+        void restoreExpandedEntries();
         
         void sendEmail();
         void visitHomepage();
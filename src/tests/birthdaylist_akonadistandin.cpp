@@ -0,0 +1,327 @@
+/**
+ * @file    birthdaylist_akonadistandin.cpp
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_akonadistandin.h"
+#include "birthdaylist_model.h"
+#include "birthdaylist_source_akonadi.h"
+#include "birthdaylist_source_collections.h"
+#include <Akonadi/CollectionModel>
+#include <Akonadi/EntityTreeModel>
+#include <KABC/Addressee>
+#include <KDebug>
+#include <KUrl>
+#include <QElapsedTimer>
+
+
+BirthdayList::AkonadiStandIn::AkonadiStandIn()
+: m_contactCollection(1),
+m_model(0),
+m_source(0),
+m_nextItemId(1),
+m_randomState(1)
+{
+    m_contactCollection.setName("Stand-in contacts");
+    m_contactCollection.setResource("birthdaylist_standin");
+    m_contactCollection.setContentMimeTypes(QStringList() << KABC::Addressee::mimeType());
+
+    QStandardItem *collectionRow = new QStandardItem(m_contactCollection.name());
+    collectionRow->setData(QVariant::fromValue(m_contactCollection), Akonadi::CollectionModel::CollectionRole);
+    m_collectionsModel.appendRow(collectionRow);
+
+    // the contacts are the children of their collection, as in the EntityTreeModel
+    QStandardItem *contactCollectionRow = new QStandardItem(m_contactCollection.name());
+    contactCollectionRow->setData(QVariant::fromValue(m_contactCollection), Akonadi::EntityTreeModel::CollectionRole);
+    m_contactsModel.appendRow(contactCollectionRow);
+}
+
+BirthdayList::AkonadiStandIn::~AkonadiStandIn()
+{
+    // the model owns the sources, which refer to the models of the stand-in
+    delete m_model;
+}
+
+BirthdayList::Model *BirthdayList::AkonadiStandIn::createModel(const ModelConfiguration &conf)
+{
+    delete m_model;
+
+    // the model must not register in the Akonadi collection by itself
+    ModelConfiguration standInConf = conf;
+    standInConf.akonadiCollectionId = -1;
+
+    Source_Collections *sourceCollections = new Source_Collections(&m_collectionsModel);
+    m_model = new Model(sourceCollections);
+    m_model->setConfiguration(standInConf);
+
+    m_source = new Source_Akonadi(*sourceCollections);
+    m_source->setContactsModel(&m_contactsModel);
+    m_model->setContactSource(m_source);
+    m_source->setCurrentCollection(m_contactCollection.id());
+
+    return m_model;
+}
+
+void BirthdayList::AkonadiStandIn::populate(int contacts)
+{
+    collectionItem()->appendRows(createContactRows(contacts));
+}
+
+int BirthdayList::AkonadiStandIn::contactCount() const
+{
+    int contacts = 0;
+    QStandardItem *collection = collectionItem();
+    for (int row=0; row<collection->rowCount(); ++row) {
+        Akonadi::Item item = collection->child(row)->data(Akonadi::EntityTreeModel::ItemRole).value<Akonadi::Item>();
+        if (item.hasPayload<KABC::Addressee>()) ++contacts;
+    }
+    return contacts;
+}
+
+void BirthdayList::AkonadiStandIn::scriptInitialSync(int contacts, int batchSize)
+{
+    for (int inserted=0; inserted<contacts; inserted+=batchSize) {
+        m_script.append(createStep(Step::ST_Insert, qMin(batchSize, contacts - inserted), 0.0, "initialSync"));
+    }
+}
+
+void BirthdayList::AkonadiStandIn::scriptDataChangedFlood(int changes, double changedFraction)
+{
+    for (int i=0; i<changes; ++i) {
+        m_script.append(createStep(Step::ST_Change, 1, changedFraction, "dataChangedFlood"));
+    }
+}
+
+void BirthdayList::AkonadiStandIn::scriptRemovals(int contacts, int batchSize)
+{
+    for (int removed=0; removed<contacts; removed+=batchSize) {
+        m_script.append(createStep(Step::ST_Remove, qMin(batchSize, contacts - removed), 0.0, "removals"));
+    }
+}
+
+bool BirthdayList::AkonadiStandIn::scriptRecording(const QString &fileName)
+{
+    QList<ChangeStreamEvent> events = ChangeStreamRecorder::load(fileName);
+    if (events.isEmpty()) return false;
+
+    int skippedEvents = 0;
+    foreach (const ChangeStreamEvent &event, events) {
+        // the stand-in has only one collection, so only the changes of the contacts in a collection are replayed
+        if (event.parentLevel != 1) {
+            ++skippedEvents;
+            continue;
+        }
+
+        Step::Type type = Step::ST_Insert;
+        if (event.type == ChangeStreamEvent::CE_DataChanged) type = Step::ST_Change;
+        else if (event.type == ChangeStreamEvent::CE_RowsRemoved) type = Step::ST_Remove;
+
+        Step step = createStep(type, event.lastRow - event.firstRow + 1, 0.0, "replay");
+        step.firstRow = event.firstRow;
+        step.rows = event.rows;
+        m_script.append(step);
+    }
+
+    kDebug() << "Akonadi stand-in: replaying" << events.size() - skippedEvents << "recorded events, skipped" << skippedEvents;
+    return true;
+}
+
+bool BirthdayList::AkonadiStandIn::performNextStep()
+{
+    if (m_script.isEmpty()) return false;
+
+    Step step = m_script.takeFirst();
+    StepResult result = { step.sequence, 0, 0 };
+    if (step.firstRow >= 0) performReplayedStep(step, collectionItem(), result);
+    else performScriptedStep(step, collectionItem(), result);
+    if (result.rows > 0) m_results.append(result);
+    return true;
+}
+
+void BirthdayList::AkonadiStandIn::performScriptedStep(const Step &step, QStandardItem *collection, StepResult &result)
+{
+    QElapsedTimer stepTimer;
+
+    if (step.type == Step::ST_Insert) {
+        QList<QStandardItem*> contactRows = createContactRows(step.count);
+
+        // all rows of the batch are announced by one rowsInserted signal
+        stepTimer.start();
+        collection->appendRows(contactRows);
+        result.rows = contactRows.size();
+    }
+    else if (step.type == Step::ST_Change && collection->rowCount() > 0) {
+        QStandardItem *contactRow = collection->child(random() % collection->rowCount());
+        Akonadi::Item item = contactRow->data(Akonadi::EntityTreeModel::ItemRole).value<Akonadi::Item>();
+
+        Akonadi::Item changedItem;
+        if (double(random() & 0xffff) / 0x10000 < step.changedFraction) {
+            changedItem = createItem(item.id(), item.revision() + 1);
+        }
+        else {
+            changedItem = item;
+            changedItem.setRevision(item.revision() + 1);
+        }
+
+        stepTimer.start();
+        contactRow->setData(QVariant::fromValue(changedItem), Akonadi::EntityTreeModel::ItemRole);
+        result.rows = 1;
+    }
+    else if (step.type == Step::ST_Remove && collection->rowCount() > 0) {
+        result.rows = qMin(step.count, collection->rowCount());
+        stepTimer.start();
+        collection->removeRows(collection->rowCount() - result.rows, result.rows);
+    }
+
+    if (result.rows > 0) result.usecs = stepTimer.nsecsElapsed() / 1000;
+}
+
+void BirthdayList::AkonadiStandIn::performReplayedStep(const Step &step, QStandardItem *collection, StepResult &result)
+{
+    QElapsedTimer stepTimer;
+    int firstRow = qMin(step.firstRow, collection->rowCount());
+
+    if (step.type == Step::ST_Insert) {
+        QList<QStandardItem*> contactRows;
+        foreach (const ContactFingerprint &fingerprint, step.rows) {
+            QStandardItem *contactRow = new QStandardItem();
+            if (fingerprint.isValid) {
+                Akonadi::Item item = createItem(m_nextItemId++, 0, fingerprint.createContact(), fingerprint.uid());
+                contactRow->setText(item.payload<KABC::Addressee>().formattedName());
+                contactRow->setData(QVariant::fromValue(item), Akonadi::EntityTreeModel::ItemRole);
+            }
+            contactRows.append(contactRow);
+        }
+
+        stepTimer.start();
+        collection->insertRows(firstRow, contactRows);
+        result.rows = contactRows.size();
+    }
+    else if (step.type == Step::ST_Change) {
+        int lastRow = qMin(firstRow + step.rows.size(), collection->rowCount()) - 1;
+        if (lastRow < firstRow) return;
+
+        // the rows are updated silently, so that the whole range can be announced by one signal as recorded
+        m_contactsModel.blockSignals(true);
+        for (int row=firstRow; row<=lastRow; ++row) {
+            const ContactFingerprint &fingerprint = step.rows[row - firstRow];
+            if (!fingerprint.isValid) continue;
+
+            QStandardItem *contactRow = collection->child(row);
+            Akonadi::Item item = contactRow->data(Akonadi::EntityTreeModel::ItemRole).value<Akonadi::Item>();
+            Akonadi::Item::Id itemId = item.isValid() ? item.id() : m_nextItemId++;
+            Akonadi::Item changedItem = createItem(itemId, item.revision() + 1, fingerprint.createContact(), fingerprint.uid());
+            contactRow->setData(QVariant::fromValue(changedItem), Akonadi::EntityTreeModel::ItemRole);
+        }
+        m_contactsModel.blockSignals(false);
+
+        stepTimer.start();
+        QMetaObject::invokeMethod(&m_contactsModel, "dataChanged", Qt::DirectConnection,
+                                  Q_ARG(QModelIndex, collection->child(firstRow)->index()),
+                                  Q_ARG(QModelIndex, collection->child(lastRow)->index()));
+        result.rows = lastRow - firstRow + 1;
+    }
+    else if (step.type == Step::ST_Remove) {
+        result.rows = qMin(step.count, collection->rowCount() - firstRow);
+        if (result.rows <= 0) return;
+
+        stepTimer.start();
+        collection->removeRows(firstRow, result.rows);
+    }
+
+    result.usecs = stepTimer.nsecsElapsed() / 1000;
+}
+
+KABC::Addressee BirthdayList::AkonadiStandIn::createAddressee(const AddresseeInfo &contactInfo, const QString &uid)
+{
+    KABC::Addressee addressee;
+    addressee.setUid(uid);
+    addressee.setFormattedName(contactInfo.name);
+    addressee.setNickName(contactInfo.nickName);
+    addressee.setGivenName(contactInfo.givenName);
+    if (!contactInfo.email.isEmpty()) addressee.insertEmail(contactInfo.email, true);
+    if (!contactInfo.homepage.isEmpty()) addressee.setUrl(KUrl(contactInfo.homepage));
+    if (contactInfo.birthday.isValid()) addressee.setBirthday(QDateTime(contactInfo.birthday));
+    addressee.setCategories(contactInfo.categories);
+
+    // the custom fields are stored as "Custom_<application>-<name>" (see Source_Contacts::fillAddresseeInfo)
+    QHashIterator<QString, QVariant> fieldIt(contactInfo.customFields);
+    while (fieldIt.hasNext()) {
+        fieldIt.next();
+        QString field = fieldIt.key().mid(QString("Custom_").length());
+        int separatorPos = field.indexOf('-');
+        QVariant value = fieldIt.value();
+        QString valueString = value.type() == QVariant::Date ? value.toDate().toString(Qt::ISODate) : value.toString();
+        addressee.insertCustom(field.left(separatorPos), field.mid(separatorPos + 1), valueString);
+    }
+
+    return addressee;
+}
+
+BirthdayList::AkonadiStandIn::Step BirthdayList::AkonadiStandIn::createStep(Step::Type type, int count, double changedFraction, const QString &sequence)
+{
+    Step step;
+    step.type = type;
+    step.count = count;
+    step.changedFraction = changedFraction;
+    step.sequence = sequence;
+    step.firstRow = -1;
+    return step;
+}
+
+Akonadi::Item BirthdayList::AkonadiStandIn::createItem(Akonadi::Item::Id itemId, int revision)
+{
+    Source_Synthetic::ContactSetParameters parameters = m_contactParameters;
+    parameters.contactCount = 1;
+    parameters.seed = random();
+    AddresseeInfo contactInfo = Source_Synthetic::createContacts(parameters, QStringList()).begin().value();
+    contactInfo.name = QString("%1 StandIn%2").arg(contactInfo.givenName).arg(itemId);
+
+    return createItem(itemId, revision, contactInfo, QString("standin-%1").arg(itemId));
+}
+
+Akonadi::Item BirthdayList::AkonadiStandIn::createItem(Akonadi::Item::Id itemId, int revision, const AddresseeInfo &contactInfo, const QString &uid)
+{
+    Akonadi::Item item(itemId);
+    item.setMimeType(KABC::Addressee::mimeType());
+    item.setRevision(revision);
+    item.setParentCollection(m_contactCollection);
+    item.setPayload<KABC::Addressee>(createAddressee(contactInfo, uid));
+    return item;
+}
+
+QList<QStandardItem*> BirthdayList::AkonadiStandIn::createContactRows(int count)
+{
+    QList<QStandardItem*> contactRows;
+    for (int i=0; i<count; ++i) {
+        Akonadi::Item item = createItem(m_nextItemId++, 0);
+        QStandardItem *contactRow = new QStandardItem(item.payload<KABC::Addressee>().formattedName());
+        contactRow->setData(QVariant::fromValue(item), Akonadi::EntityTreeModel::ItemRole);
+        contactRows.append(contactRow);
+    }
+    return contactRows;
+}
+
+QStandardItem *BirthdayList::AkonadiStandIn::collectionItem() const
+{
+    return m_contactsModel.item(0);
+}
+
+uint BirthdayList::AkonadiStandIn::random()
+{
+    m_randomState = m_randomState * 1103515245u + 12345u;
+    return m_randomState >> 8;
+}
@@ -0,0 +1,145 @@
+#ifndef BIRTHDAYLIST_AKONADISTANDIN_H
+#define BIRTHDAYLIST_AKONADISTANDIN_H
+
+/**
+ * @file    birthdaylist_akonadistandin.h
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_changestream.h"
+#include "birthdaylist_source_synthetic.h"
+#include <Akonadi/Collection>
+#include <Akonadi/Item>
+#include <QList>
+#include <QStandardItemModel>
+
+namespace KABC {
+    class Addressee;
+}
+
+
+namespace BirthdayList 
+{
+    class Model;
+    class Source_Akonadi;
+
+    /**
+    * Offline replacement of the Akonadi server for measuring Source_Collections and Source_Akonadi.
+    * It provides the collections and contact items in models laid out like the EntityTreeModel
+    * (the contacts are the children of their collection row) and replays scripted sequences
+    * of model signals, such as the initial synchronisation arriving in batches or a flood of dataChanged signals.
+    * The steps are performed one by one by the caller; the duration of every step includes the processing
+    * in the contact source and the refresh of the model.
+    */
+    class AkonadiStandIn
+    {
+    public:
+        /** Duration of one performed step */
+        struct StepResult {
+            QString sequence;
+            int rows;
+            qint64 usecs;
+        };
+
+        AkonadiStandIn();
+        ~AkonadiStandIn();
+
+        /** Creates a model reading its contacts from the stand-in through Source_Collections and Source_Akonadi */
+        Model *createModel(const ModelConfiguration &conf);
+        /** Returns the contact source of the model created by createModel */
+        Source_Akonadi *contactSource() {
+            return m_source;
+        }
+
+        QAbstractItemModel *collectionsModel() {
+            return &m_collectionsModel;
+        }
+        QAbstractItemModel *contactsModel() {
+            return &m_contactsModel;
+        }
+        Akonadi::Collection::Id contactCollectionId() const {
+            return m_contactCollection.id();
+        }
+
+        /** Inserts the given number of contacts immediately (as if the Akonadi server had them before the applet started) */
+        void populate(int contacts);
+        /** Returns the number of the contact items in the collection */
+        int contactCount() const;
+
+        /** Appends the insertion of the given number of contacts in rows batches of the given size to the script */
+        void scriptInitialSync(int contacts, int batchSize = 100);
+        /** Appends the given number of single-row dataChanged signals to the script; only the given fraction
+        *  of them changes the contact (the rest only increases the item revision, e.g. as a flag change would) */
+        void scriptDataChangedFlood(int changes, double changedFraction = 0.1);
+        /** Appends the removal of the given number of contacts in batches of the given size to the script */
+        void scriptRemovals(int contacts, int batchSize = 100);
+
+        /** Appends the signals recorded by Source_Akonadi (see ChangeStreamRecorder) to the script (without the
+        *  recorded delays); returns false if the recording cannot be read */
+        bool scriptRecording(const QString &fileName);
+
+        /** Performs the next step of the script; returns false if the script is finished */
+        bool performNextStep();
+        int remainingSteps() const {
+            return m_script.size();
+        }
+        /** Returns the durations of the performed steps */
+        const QList<StepResult>& results() const {
+            return m_results;
+        }
+
+        /** Creates the Akonadi contact corresponding to the given contact information */
+        static KABC::Addressee createAddressee(const AddresseeInfo &contactInfo, const QString &uid);
+
+    private:
+        struct Step {
+            enum Type { ST_Insert, ST_Change, ST_Remove };
+            Type type;
+            int count;
+            double changedFraction;
+            QString sequence;
+            /** Replayed steps only: the affected rows and their contacts */
+            int firstRow;
+            QList<ContactFingerprint> rows;
+        };
+        static Step createStep(Step::Type type, int count, double changedFraction, const QString &sequence);
+
+        Akonadi::Item createItem(Akonadi::Item::Id itemId, int revision);
+        Akonadi::Item createItem(Akonadi::Item::Id itemId, int revision, const AddresseeInfo &contactInfo, const QString &uid);
+        QList<QStandardItem*> createContactRows(int count);
+        void performScriptedStep(const Step &step, QStandardItem *collection, StepResult &result);
+        void performReplayedStep(const Step &step, QStandardItem *collection, StepResult &result);
+        QStandardItem *collectionItem() const;
+        uint random();
+
+    private:
+        QStandardItemModel m_collectionsModel;
+        QStandardItemModel m_contactsModel;
+        Akonadi::Collection m_contactCollection;
+        Model *m_model;
+        Source_Akonadi *m_source;
+
+        Source_Synthetic::ContactSetParameters m_contactParameters;
+        Akonadi::Item::Id m_nextItemId;
+        uint m_randomState;
+
+        QList<Step> m_script;
+        QList<StepResult> m_results;
+    };
+};
+
+
+#endif //BIRTHDAYLIST_AKONADISTANDIN_H
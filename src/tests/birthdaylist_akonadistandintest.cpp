@@ -0,0 +1,175 @@
+/**
+ * @file    birthdaylist_akonadistandintest.cpp
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_akonadistandin.h"
+#include "birthdaylist_model.h"
+#include "birthdaylist_source_akonadi.h"
+#include <KDebug>
+#include <KTempDir>
+#include <qtest_kde.h>
+
+
+namespace BirthdayList 
+{
+    /** Contact source holding a fixed contact set (used to build the reference events) */
+    class Source_Fixed : public Source_Contacts
+    {
+    public:
+        explicit Source_Fixed(const QHash<QString, AddresseeInfo> &contacts) : m_contacts(contacts) {
+        }
+
+        virtual const QHash<QString, AddresseeInfo>& getAllContacts() {
+            return m_contacts;
+        }
+
+    private:
+        QHash<QString, AddresseeInfo> m_contacts;
+    };
+
+
+    /**
+    * Plays the scripted signal sequences of the Akonadi stand-in into Source_Akonadi and checks after every step
+    * that the source holds exactly the contacts of the stand-in collection and that the model has the same
+    * events as a model built from scratch from these contacts. The same is checked for a recording of the signals
+    * made by Source_Akonadi (see BIRTHDAYLIST_RECORD_AKONADI) replayed into a fresh stand-in.
+    */
+    class AkonadiStandInTest : public QObject
+    {
+        Q_OBJECT
+    private slots:
+        void initTestCase();
+
+        void scriptedSequences_data();
+        void scriptedSequences();
+        void recordedSequences();
+
+    private:
+        /** Performs all steps of the script and checks the contacts and events after each of them */
+        void playScript(AkonadiStandIn &standIn, Model *model);
+        /** Returns the number of events of a model reading the given contacts */
+        int referenceEventCount(const QHash<QString, AddresseeInfo> &contacts);
+
+        ModelConfiguration m_conf;
+    };
+};
+
+
+void BirthdayList::AkonadiStandInTest::initTestCase()
+{
+    m_conf.curNamedayFile = BIRTHDAYLIST_NAMEDAYDEFS_DIR "/namedays_sk.txt";
+    m_conf.namedayByCustomDateField = true;
+    m_conf.namedayCustomDateFieldName = "X-Nameday";
+    m_conf.eventThreshold = 366;
+}
+
+void BirthdayList::AkonadiStandInTest::scriptedSequences_data()
+{
+    QTest::addColumn<int>("contacts");
+    QTest::addColumn<int>("batchSize");
+    QTest::addColumn<int>("changes");
+
+    QTest::newRow("single rows") << 50 << 1 << 50;
+    QTest::newRow("batches") << 1000 << 100 << 200;
+}
+
+void BirthdayList::AkonadiStandInTest::scriptedSequences()
+{
+    QFETCH(int, contacts);
+    QFETCH(int, batchSize);
+    QFETCH(int, changes);
+
+    AkonadiStandIn standIn;
+    Model *model = standIn.createModel(m_conf);
+    QCOMPARE(model->eventCount(), 0);
+
+    standIn.scriptInitialSync(contacts, batchSize);
+    standIn.scriptDataChangedFlood(changes);
+    standIn.scriptRemovals(contacts / 10, batchSize);
+    playScript(standIn, model);
+    if (QTest::currentTestFailed()) return;
+
+    QCOMPARE(standIn.contactCount(), contacts - contacts / 10);
+}
+
+void BirthdayList::AkonadiStandInTest::recordedSequences()
+{
+    KTempDir recordingDir;
+    QString recordingFile = recordingDir.name() + "changes.stream";
+
+    // the recorder is created by the contact source of the model when the variable is set
+    int recordedContacts = 0;
+    {
+        qputenv("BIRTHDAYLIST_RECORD_AKONADI", QFile::encodeName(recordingFile));
+        AkonadiStandIn recordedStandIn;
+        recordedStandIn.createModel(m_conf);
+        qputenv("BIRTHDAYLIST_RECORD_AKONADI", QByteArray());
+
+        recordedStandIn.scriptInitialSync(200, 20);
+        recordedStandIn.scriptDataChangedFlood(100, 0.5);
+        recordedStandIn.scriptRemovals(20, 10);
+        while (recordedStandIn.performNextStep());
+        recordedContacts = recordedStandIn.contactCount();
+    }
+
+    AkonadiStandIn standIn;
+    Model *model = standIn.createModel(m_conf);
+    QVERIFY(standIn.scriptRecording(recordingFile));
+    QVERIFY(standIn.remainingSteps() > 0);
+    playScript(standIn, model);
+    if (QTest::currentTestFailed()) return;
+
+    QCOMPARE(standIn.contactCount(), recordedContacts);
+}
+
+void BirthdayList::AkonadiStandInTest::playScript(AkonadiStandIn &standIn, Model *model)
+{
+    for (int step=1; standIn.performNextStep(); ++step) {
+        const QHash<QString, AddresseeInfo> &contacts = standIn.contactSource()->getAllContacts();
+        QVERIFY2(contacts.size() == standIn.contactCount(),
+                 qPrintable(QString("Step %1: %2 contacts in the source, %3 in the stand-in").arg(step).arg(contacts.size()).arg(standIn.contactCount())));
+
+        int expectedEvents = referenceEventCount(contacts);
+        QVERIFY2(model->eventCount() == expectedEvents,
+                 qPrintable(QString("Step %1: %2 events in the model, %3 expected").arg(step).arg(model->eventCount()).arg(expectedEvents)));
+    }
+
+    QHash<QString, qint64> sequenceUsecs;
+    foreach (const AkonadiStandIn::StepResult &result, standIn.results()) {
+        sequenceUsecs[result.sequence] += result.usecs;
+    }
+    QHashIterator<QString, qint64> sequenceIt(sequenceUsecs);
+    while (sequenceIt.hasNext()) {
+        sequenceIt.next();
+        kDebug() << "Akonadi stand-in:" << sequenceIt.key() << "took" << sequenceIt.value() << "us";
+    }
+}
+
+int BirthdayList::AkonadiStandInTest::referenceEventCount(const QHash<QString, AddresseeInfo> &contacts)
+{
+    Model referenceModel;
+    referenceModel.holdSources();
+    referenceModel.setConfiguration(m_conf);
+    referenceModel.setContactSource(new Source_Fixed(contacts));
+    referenceModel.performDayRollover();
+    return referenceModel.eventCount();
+}
+
+
+QTEST_KDEMAIN(BirthdayList::AkonadiStandInTest, GUI)
+
+#include "birthdaylist_akonadistandintest.moc"
@@ -0,0 +1,404 @@
+/**
+ * @file    birthdaylist_modelbenchmark.cpp
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_clock.h"
+#include "birthdaylist_model.h"
+#include "birthdaylist_modelentry.h"
+#include "birthdaylist_source_synthetic.h"
+#include <qtest_kde.h>
+#include <QRegExp>
+
+
+namespace BirthdayList 
+{
+    /**
+    * Model with its refresh stages made public for the benchmark.
+    */
+    class BenchmarkedModel : public Model
+    {
+    public:
+        using Model::loadNamedayCalendar;
+        using Model::isContactAccepted;
+        using Model::getContactNameday;
+        using Model::createContactEntries;
+        using Model::aggregateNamedayEntries;
+        using Model::getContactDateField;
+        using Model::getNamedayByGivenName;
+        using Model::refreshContactEvents;
+        using Model::deleteEventEntries;
+        using Model::updateModel;
+        using Model::eventEntries;
+        using Model::namedayCalendar;
+    };
+
+    /**
+    * Measures the stages of the model refresh on synthetic contact sets of 1000 up to 1000000 contacts.
+    * The model keeps its sources held, so it never connects to Akonadi and only the synthetic contact source
+    * is measured. Run with -iterations or -callgrind to get stable numbers and with -csv or -xml -o <file>
+    * to get them in a machine-readable form (the birthdaylist-modelbenchmark-results target writes the CSV).
+    * The fractions of the contacts having the dates and the filter fields can be set by BIRTHDAYLIST_BENCHMARK_DENSITIES,
+    * e.g. "birthday=0.8,anniversary=0.2,namedayField=0.1,category=0.3,customField=0.25".
+    */
+    class ModelBenchmark : public QObject
+    {
+        Q_OBJECT
+    private slots:
+        void initTestCase();
+        void cleanupTestCase();
+
+        void loadNamedays();
+        void getNamedayByGivenName_data();
+        void getNamedayByGivenName();
+        void filter_data();
+        void filter();
+        void createEntries_data();
+        void createEntries();
+        void aggregation_data();
+        void aggregation();
+        void refreshContactEvents_data();
+        void refreshContactEvents();
+        void sort_data();
+        void sort();
+        void updateModel_data();
+        void updateModel();
+        void populateAllRows_data();
+        void populateAllRows();
+
+    private:
+        /** Adds the contactCount column and the measured contact set sizes */
+        void addContactCounts();
+        /** Reads the contact densities from BIRTHDAYLIST_BENCHMARK_DENSITIES; returns false if it cannot be parsed */
+        bool readDensities();
+        /** Gives the model a synthetic contact source of the given size (the previous one is reused if it has the same size) */
+        void prepareContacts(int contactCount);
+        /** Deletes all event entries of the model and its rows */
+        void resetModelEntries();
+        /** Creates the individual nameday entries of all contacts for the aggregation stage */
+        QList<NamedayEntry*> createNamedayEntries();
+        QStringList calendarGivenNames() const;
+
+        ModelConfiguration m_conf;
+        Source_Synthetic::ContactSetParameters m_parameters;
+        SimulatedClock *m_clock;
+        BenchmarkedModel *m_model;
+        QHash<QString, AddresseeInfo> m_contacts;
+
+        /** Sizes of the measured contact sets */
+        static const int m_contactCounts[];
+        /** Number of the given names looked up by one repetition (the lookup iterates over the whole calendar) */
+        static const int m_namedaySampleSize = 1000;
+    };
+};
+
+
+const int BirthdayList::ModelBenchmark::m_contactCounts[] = { 1000, 10000, 100000, 1000000 };
+
+
+void BirthdayList::ModelBenchmark::initTestCase()
+{
+    m_conf.curNamedayFile = BIRTHDAYLIST_NAMEDAYDEFS_DIR "/namedays_sk.txt";
+    m_conf.namedayByGivenName = true;
+    m_conf.namedayByCustomDateField = true;
+    m_conf.namedayCustomDateFieldName = "X-Nameday";
+    QVERIFY2(readDensities(), "BIRTHDAYLIST_BENCHMARK_DENSITIES must be a list of <field>=<fraction> items");
+
+    // the events are always computed for the same day, so that the results are comparable
+    m_clock = new SimulatedClock(QDate(2013, 6, 15));
+    m_model = new BenchmarkedModel();
+    m_model->setClock(m_clock);
+    m_model->holdSources();
+    m_model->setConfiguration(m_conf);
+    QVERIFY(!m_model->namedayCalendar().isEmpty());
+}
+
+void BirthdayList::ModelBenchmark::cleanupTestCase()
+{
+    delete m_model;
+    delete m_clock;
+}
+
+bool BirthdayList::ModelBenchmark::readDensities()
+{
+    QString densities = QString::fromLocal8Bit(qgetenv("BIRTHDAYLIST_BENCHMARK_DENSITIES"));
+    foreach (const QString &density, densities.split(',', QString::SkipEmptyParts)) {
+        QString field = density.section('=', 0, 0).trimmed();
+        bool valid = false;
+        double fraction = density.section('=', 1).toDouble(&valid);
+        if (!valid || fraction < 0.0 || fraction > 1.0) return false;
+
+        if (field == "birthday") m_parameters.birthdayDensity = fraction;
+        else if (field == "anniversary") m_parameters.anniversaryDensity = fraction;
+        else if (field == "namedayField") m_parameters.namedayFieldDensity = fraction;
+        else if (field == "category") m_parameters.categoryDensity = fraction;
+        else if (field == "customField") m_parameters.customFieldDensity = fraction;
+        else return false;
+    }
+    return true;
+}
+
+void BirthdayList::ModelBenchmark::addContactCounts()
+{
+    QTest::addColumn<int>("contactCount");
+    for (unsigned i=0; i<sizeof(m_contactCounts) / sizeof(m_contactCounts[0]); ++i) {
+        QTest::newRow(QString("%1 contacts").arg(m_contactCounts[i]).toLatin1()) << m_contactCounts[i];
+    }
+}
+
+void BirthdayList::ModelBenchmark::prepareContacts(int contactCount)
+{
+    resetModelEntries();
+    if (m_contacts.size() == contactCount) return;
+
+    Source_Synthetic::ContactSetParameters parameters = m_parameters;
+    parameters.contactCount = contactCount;
+    Source_Synthetic *source = new Source_Synthetic(parameters, calendarGivenNames());
+    m_contacts = source->getAllContacts();
+    m_model->setContactSource(source);
+}
+
+void BirthdayList::ModelBenchmark::loadNamedays()
+{
+    QBENCHMARK {
+        m_model->loadNamedayCalendar(m_conf.curNamedayFile);
+    }
+    QVERIFY(!m_model->namedayCalendar().isEmpty());
+}
+
+void BirthdayList::ModelBenchmark::getNamedayByGivenName_data()
+{
+    addContactCounts();
+}
+
+void BirthdayList::ModelBenchmark::getNamedayByGivenName()
+{
+    QFETCH(int, contactCount);
+    prepareContacts(contactCount);
+
+    QStringList givenNames;
+    QHashIterator<QString, AddresseeInfo> contactIt(m_contacts);
+    while (contactIt.hasNext() && givenNames.size() < m_namedaySampleSize) {
+        givenNames.append(contactIt.next().value().givenName);
+    }
+
+    int foundNamedays = 0;
+    QBENCHMARK {
+        foundNamedays = 0;
+        foreach (const QString &givenName, givenNames) {
+            if (m_model->getNamedayByGivenName(givenName).isValid()) ++foundNamedays;
+        }
+    }
+    // the given names are picked from the calendar
+    QVERIFY(foundNamedays > 0);
+}
+
+void BirthdayList::ModelBenchmark::filter_data()
+{
+    QTest::addColumn<int>("contactCount");
+    QTest::addColumn<int>("filterType");
+    QTest::addColumn<QString>("filterValue");
+
+    for (unsigned i=0; i<sizeof(m_contactCounts) / sizeof(m_contactCounts[0]); ++i) {
+        int contactCount = m_contactCounts[i];
+        QTest::newRow(QString("off, %1 contacts").arg(contactCount).toLatin1())
+            << contactCount << int(ModelConfiguration::FT_Off) << QString();
+        QTest::newRow(QString("customField, %1 contacts").arg(contactCount).toLatin1())
+            << contactCount << int(ModelConfiguration::FT_CustomField) << QString(Source_Synthetic::m_filterValue);
+        QTest::newRow(QString("customFieldPrefix, %1 contacts").arg(contactCount).toLatin1())
+            << contactCount << int(ModelConfiguration::FT_CustomFieldPrefix) << QString(Source_Synthetic::m_filterValue);
+        QTest::newRow(QString("category, %1 contacts").arg(contactCount).toLatin1())
+            << contactCount << int(ModelConfiguration::FT_Category) << QString(Source_Synthetic::m_filterCategory);
+    }
+}
+
+void BirthdayList::ModelBenchmark::filter()
+{
+    QFETCH(int, contactCount);
+    QFETCH(int, filterType);
+    QFETCH(QString, filterValue);
+    prepareContacts(contactCount);
+
+    ModelConfiguration filterConf = m_conf;
+    filterConf.filterType = ModelConfiguration::FilterType(filterType);
+    filterConf.customFieldName = QString(Source_Synthetic::m_filterCustomFieldPrefix) + "0";
+    filterConf.customFieldPrefix = Source_Synthetic::m_filterCustomFieldPrefix;
+    filterConf.filterValue = filterValue;
+    m_model->setConfiguration(filterConf);
+
+    int acceptedContacts = 0;
+    QBENCHMARK {
+        acceptedContacts = 0;
+        foreach (const AddresseeInfo &contactInfo, m_contacts) {
+            if (m_model->isContactAccepted(contactInfo)) ++acceptedContacts;
+        }
+    }
+    m_model->setConfiguration(m_conf);
+    QVERIFY(acceptedContacts > 0);
+}
+
+void BirthdayList::ModelBenchmark::createEntries_data()
+{
+    addContactCounts();
+}
+
+void BirthdayList::ModelBenchmark::createEntries()
+{
+    QFETCH(int, contactCount);
+    prepareContacts(contactCount);
+
+    // the entries have to be deleted before the next repetition, which is measured as well
+    QBENCHMARK {
+        QList<NamedayEntry*> namedayEntries;
+        foreach (const AddresseeInfo &contactInfo, m_contacts) {
+            QDate contactNameday;
+            if (m_conf.showNamedays) contactNameday = m_model->getContactNameday(contactInfo);
+            m_model->createContactEntries(contactInfo, contactNameday, namedayEntries);
+        }
+        qDeleteAll(namedayEntries);
+        resetModelEntries();
+    }
+}
+
+void BirthdayList::ModelBenchmark::aggregation_data()
+{
+    addContactCounts();
+}
+
+void BirthdayList::ModelBenchmark::aggregation()
+{
+    QFETCH(int, contactCount);
+    prepareContacts(contactCount);
+
+    // the aggregation takes the ownership of the nameday entries, so they are created by every repetition
+    QBENCHMARK {
+        QList<NamedayEntry*> namedayEntries = createNamedayEntries();
+        m_model->aggregateNamedayEntries(namedayEntries, m_clock->currentDate());
+        resetModelEntries();
+    }
+}
+
+void BirthdayList::ModelBenchmark::refreshContactEvents_data()
+{
+    addContactCounts();
+}
+
+void BirthdayList::ModelBenchmark::refreshContactEvents()
+{
+    QFETCH(int, contactCount);
+    prepareContacts(contactCount);
+
+    QBENCHMARK {
+        m_model->refreshContactEvents();
+    }
+    QVERIFY(m_model->eventCount() > 0);
+}
+
+void BirthdayList::ModelBenchmark::sort_data()
+{
+    addContactCounts();
+}
+
+void BirthdayList::ModelBenchmark::sort()
+{
+    QFETCH(int, contactCount);
+    prepareContacts(contactCount);
+    m_model->refreshContactEvents();
+
+    // every repetition sorts the same shuffled copy of the event list
+    QList<AbstractAnnualEventEntry*> shuffledEntries = m_model->eventEntries();
+    qsrand(contactCount);
+    for (int i=shuffledEntries.size() - 1; i>0; --i) shuffledEntries.swap(i, qrand() % (i + 1));
+
+    QBENCHMARK {
+        QList<AbstractAnnualEventEntry*> entries = shuffledEntries;
+        AbstractAnnualEventEntry::sortEntries(entries);
+    }
+}
+
+void BirthdayList::ModelBenchmark::updateModel_data()
+{
+    addContactCounts();
+}
+
+void BirthdayList::ModelBenchmark::updateModel()
+{
+    QFETCH(int, contactCount);
+    prepareContacts(contactCount);
+    m_model->refreshContactEvents();
+
+    QBENCHMARK {
+        m_model->updateModel();
+    }
+    QVERIFY(m_model->rowCount() > 0);
+}
+
+void BirthdayList::ModelBenchmark::populateAllRows_data()
+{
+    addContactCounts();
+}
+
+void BirthdayList::ModelBenchmark::populateAllRows()
+{
+    QFETCH(int, contactCount);
+    prepareContacts(contactCount);
+    m_model->refreshContactEvents();
+
+    // the same as updateModel, but the view scrolls down to the last row
+    QBENCHMARK {
+        m_model->updateModel();
+        while (m_model->canFetchMore(QModelIndex())) m_model->fetchMore(QModelIndex());
+    }
+    QVERIFY(m_model->rowCount() > 0);
+    QVERIFY(!m_model->canFetchMore(QModelIndex()));
+}
+
+void BirthdayList::ModelBenchmark::resetModelEntries()
+{
+    m_model->setRowCount(0);
+    m_model->deleteEventEntries();
+}
+
+QList<BirthdayList::NamedayEntry*> BirthdayList::ModelBenchmark::createNamedayEntries()
+{
+    QList<NamedayEntry*> namedayEntries;
+    foreach (const AddresseeInfo &contactInfo, m_contacts) {
+        QDate namedayDate = m_model->getContactDateField(contactInfo, "X-Nameday");
+        if (namedayDate.isValid()) namedayEntries.append(new NamedayEntry(contactInfo.name, namedayDate, contactInfo.email, contactInfo.homepage));
+    }
+
+    QList<AbstractAnnualEventEntry*> timedEntries;
+    foreach (NamedayEntry *namedayEntry, namedayEntries) {
+        timedEntries.append(namedayEntry);
+    }
+    AbstractAnnualEventEntry::updateTiming(timedEntries, m_clock->currentDate(), m_conf.pastThreshold);
+
+    return namedayEntries;
+}
+
+QStringList BirthdayList::ModelBenchmark::calendarGivenNames() const
+{
+    QStringList givenNames;
+    foreach (const QString &namedayString, m_model->namedayCalendar()) {
+        givenNames += namedayString.split(QRegExp("\\W+"), QString::SkipEmptyParts);
+    }
+    return givenNames;
+}
+
+
+QTEST_KDEMAIN(BirthdayList::ModelBenchmark, GUI)
+
+#include "birthdaylist_modelbenchmark.moc"
@@ -0,0 +1,264 @@
+/**
+ * @file    birthdaylist_renderbenchmark.cpp
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_model.h"
+#include "birthdaylist_source_synthetic.h"
+#include "birthdaylist_view.h"
+#include <qtest_kde.h>
+#include <QGraphicsScene>
+#include <QImage>
+#include <QPainter>
+#include <QStyledItemDelegate>
+#include <QScrollBar>
+#include <QTreeView>
+
+
+namespace BirthdayList 
+{
+    /**
+    * Measures the paint and layout cost of the view: the model and the view are hosted in an offscreen
+    * graphics scene, which is rendered into an image by every repetition. The model keeps its sources held
+    * and shows all birthdays of a synthetic contact set, so the number of rows is about the number of contacts.
+    * Every operation is measured with the row pixmaps of CachedItemDelegate and with a plain QStyledItemDelegate.
+    */
+    class RenderBenchmark : public QObject
+    {
+        Q_OBJECT
+    private slots:
+        void initTestCase();
+        void cleanup();
+
+        void firstPaint_data();
+        void firstPaint();
+        void scrollRepaint_data();
+        void scrollRepaint();
+        void expandCollapse_data();
+        void expandCollapse();
+        void themeChange_data();
+        void themeChange();
+        void reopenPopup_data();
+        void reopenPopup();
+
+    private:
+        /** Adds the rowCount and cachedRows columns, the measured model sizes with and without the cached rows */
+        void addRowCounts();
+        /** Creates the model of the given size with all rows populated */
+        void createModel(int rowCount);
+        /** Creates a new view of the model in the scene, painting the rows through the view's delegate or a plain one */
+        void createView(bool cachedRows);
+        /** Renders the scene into the offscreen image */
+        void render();
+
+        ModelConfiguration m_modelConf;
+        ViewConfiguration m_viewConf;
+        Model *m_model;
+        View *m_view;
+        QGraphicsScene *m_scene;
+        QStyledItemDelegate *m_plainDelegate;
+        QImage m_image;
+
+        /** Number of the aggregated rows expanded and collapsed by one repetition */
+        static const int m_expandedRowCount = 10;
+    };
+};
+
+
+void BirthdayList::RenderBenchmark::initTestCase()
+{
+    // every birthday of the synthetic contacts is shown
+    m_modelConf.curNamedayFile = BIRTHDAYLIST_NAMEDAYDEFS_DIR "/namedays_sk.txt";
+    m_modelConf.namedayByCustomDateField = true;
+    m_modelConf.namedayCustomDateFieldName = "X-Nameday";
+    m_modelConf.eventThreshold = 366;
+    m_modelConf.pastThreshold = 0;
+
+    m_model = 0;
+    m_view = 0;
+    m_image = QImage(400, 600, QImage::Format_ARGB32_Premultiplied);
+    m_scene = new QGraphicsScene(this);
+    m_plainDelegate = new QStyledItemDelegate(this);
+    m_scene->setSceneRect(0, 0, m_image.width(), m_image.height());
+}
+
+void BirthdayList::RenderBenchmark::cleanup()
+{
+    delete m_view;
+    m_view = 0;
+    delete m_model;
+    m_model = 0;
+}
+
+void BirthdayList::RenderBenchmark::addRowCounts()
+{
+    QTest::addColumn<int>("rowCount");
+    QTest::addColumn<bool>("cachedRows");
+
+    const int rowCounts[] = { 100, 1000, 10000 };
+    for (unsigned i=0; i<sizeof(rowCounts) / sizeof(rowCounts[0]); ++i) {
+        QTest::newRow(QString("%1 rows, cached").arg(rowCounts[i]).toLatin1()) << rowCounts[i] << true;
+        QTest::newRow(QString("%1 rows, plain").arg(rowCounts[i]).toLatin1()) << rowCounts[i] << false;
+    }
+}
+
+void BirthdayList::RenderBenchmark::createModel(int rowCount)
+{
+    Source_Synthetic::ContactSetParameters parameters;
+    parameters.contactCount = rowCount;
+    parameters.birthdayDensity = 1.0;
+    parameters.anniversaryDensity = 0.0;
+
+    m_model = new Model();
+    m_model->holdSources();
+    m_model->setConfiguration(m_modelConf);
+    m_model->setContactSource(new Source_Synthetic(parameters));
+    m_model->performDayRollover();
+
+    // the rows are created in pages as the view scrolls, create all of them so that the scrolling measures only the painting
+    while (m_model->canFetchMore(QModelIndex())) m_model->fetchMore(QModelIndex());
+}
+
+void BirthdayList::RenderBenchmark::firstPaint_data()
+{
+    addRowCounts();
+}
+
+void BirthdayList::RenderBenchmark::firstPaint()
+{
+    QFETCH(int, rowCount);
+    QFETCH(bool, cachedRows);
+    createModel(rowCount);
+
+    // the view is created, laid out and painted for the first time
+    QBENCHMARK {
+        createView(cachedRows);
+        render();
+    }
+}
+
+void BirthdayList::RenderBenchmark::scrollRepaint_data()
+{
+    addRowCounts();
+}
+
+void BirthdayList::RenderBenchmark::scrollRepaint()
+{
+    QFETCH(int, rowCount);
+    QFETCH(bool, cachedRows);
+    createModel(rowCount);
+    createView(cachedRows);
+    render();
+
+    // scrolls by one page, from the top again when the end is reached
+    QScrollBar *scrollBar = m_view->nativeWidget()->verticalScrollBar();
+    QBENCHMARK {
+        scrollBar->setValue(scrollBar->value() < scrollBar->maximum() ? scrollBar->value() + scrollBar->pageStep() : 0);
+        render();
+    }
+}
+
+void BirthdayList::RenderBenchmark::expandCollapse_data()
+{
+    addRowCounts();
+}
+
+void BirthdayList::RenderBenchmark::expandCollapse()
+{
+    QFETCH(int, rowCount);
+    QFETCH(bool, cachedRows);
+    createModel(rowCount);
+    createView(cachedRows);
+
+    QTreeView *treeView = m_view->nativeWidget();
+    QList<QModelIndex> expandedIndexes;
+    for (int row=0; row<m_model->rowCount() && expandedIndexes.size() < m_expandedRowCount; ++row) {
+        QModelIndex index = m_model->index(row, 0);
+        if (m_model->hasChildren(index)) expandedIndexes.append(index);
+    }
+    if (expandedIndexes.isEmpty()) QSKIP("The model has no aggregated rows", SkipSingle);
+    treeView->scrollTo(expandedIndexes.first());
+    render();
+
+    QBENCHMARK {
+        foreach (const QModelIndex &index, expandedIndexes) treeView->expand(index);
+        render();
+        foreach (const QModelIndex &index, expandedIndexes) treeView->collapse(index);
+        render();
+    }
+}
+
+void BirthdayList::RenderBenchmark::themeChange_data()
+{
+    addRowCounts();
+}
+
+void BirthdayList::RenderBenchmark::themeChange()
+{
+    QFETCH(int, rowCount);
+    QFETCH(bool, cachedRows);
+    createModel(rowCount);
+    createView(cachedRows);
+    render();
+
+    QBENCHMARK {
+        m_view->usePlasmaThemeColors();
+        render();
+    }
+}
+
+void BirthdayList::RenderBenchmark::reopenPopup_data()
+{
+    addRowCounts();
+}
+
+void BirthdayList::RenderBenchmark::reopenPopup()
+{
+    QFETCH(int, rowCount);
+    QFETCH(bool, cachedRows);
+    createModel(rowCount);
+    createView(cachedRows);
+    render();
+
+    // the popup hides the view and shows it again unchanged
+    QBENCHMARK {
+        m_view->hide();
+        m_view->show();
+        render();
+    }
+}
+
+void BirthdayList::RenderBenchmark::createView(bool cachedRows)
+{
+    delete m_view;
+    m_view = new View(m_model, 0);
+    if (!cachedRows) m_view->nativeWidget()->setItemDelegate(m_plainDelegate);
+    m_scene->addItem(m_view);
+    m_view->setGeometry(m_scene->sceneRect());
+    m_view->setConfiguration(m_viewConf);
+}
+
+void BirthdayList::RenderBenchmark::render()
+{
+    m_image.fill(0);
+    QPainter painter(&m_image);
+    m_scene->render(&painter);
+}
+
+
+QTEST_KDEMAIN(BirthdayList::RenderBenchmark, GUI)
+
+#include "birthdaylist_renderbenchmark.moc"
@@ -0,0 +1,142 @@
+/**
+ * @file    birthdaylist_rollovertest.cpp
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_clock.h"
+#include "birthdaylist_model.h"
+#include "birthdaylist_source_synthetic.h"
+#include <qtest_kde.h>
+
+
+namespace BirthdayList 
+{
+    /**
+    * Steps a model through a sequence of days using the simulated clock and checks after every
+    * day rollover that the event timing is consistent with the new day (across the year boundaries
+    * and the leap days), and measures the cost of one rollover. The model keeps its sources held
+    * and reads synthetic contacts only.
+    */
+    class RolloverTest : public QObject
+    {
+        Q_OBJECT
+    private slots:
+        void initTestCase();
+
+        void rollover_data();
+        void rollover();
+        void rolloverCost_data();
+        void rolloverCost();
+
+    private:
+        ModelConfiguration m_conf;
+    };
+};
+
+
+void BirthdayList::RolloverTest::initTestCase()
+{
+    m_conf.curNamedayFile = BIRTHDAYLIST_NAMEDAYDEFS_DIR "/namedays_sk.txt";
+    m_conf.namedayByGivenName = true;
+    m_conf.namedayByCustomDateField = true;
+    m_conf.namedayCustomDateFieldName = "X-Nameday";
+}
+
+void BirthdayList::RolloverTest::rollover_data()
+{
+    QTest::addColumn<QDate>("firstDay");
+    QTest::addColumn<int>("days");
+    QTest::addColumn<int>("namedayDisplayMode");
+
+    QTest::newRow("year from mid-year") << QDate(2013, 6, 15) << 400 << int(ModelConfiguration::NDM_AggregateEvents);
+    QTest::newRow("leap year") << QDate(2011, 12, 20) << 450 << int(ModelConfiguration::NDM_AggregateEvents);
+    QTest::newRow("leap year, individual namedays") << QDate(2011, 12, 20) << 450 << int(ModelConfiguration::NDM_IndividualEvents);
+    QTest::newRow("leap year, all calendar names") << QDate(2011, 12, 20) << 450 << int(ModelConfiguration::NDM_AllCalendarNames);
+}
+
+void BirthdayList::RolloverTest::rollover()
+{
+    QFETCH(QDate, firstDay);
+    QFETCH(int, days);
+    QFETCH(int, namedayDisplayMode);
+
+    ModelConfiguration conf = m_conf;
+    conf.namedayDisplayMode = ModelConfiguration::NamedayDisplayMode(namedayDisplayMode);
+
+    SimulatedClock clock(firstDay);
+    Model model;
+    model.setClock(&clock);
+    model.holdSources();
+    model.setConfiguration(conf);
+
+    Source_Synthetic::ContactSetParameters parameters;
+    model.setContactSource(new Source_Synthetic(parameters));
+    model.performDayRollover();
+    QVERIFY(model.eventCount() > 0);
+    QCOMPARE(model.checkEventTiming(), QString());
+
+    for (int day=0; day<days; ++day) {
+        clock.advanceDays(1);
+        model.performDayRollover();
+
+        QString inconsistency = model.checkEventTiming();
+        if (!inconsistency.isEmpty()) {
+            QFAIL(qPrintable(QString("Inconsistent events on %1: %2").arg(clock.currentDate().toString(Qt::ISODate)).arg(inconsistency)));
+        }
+    }
+}
+
+void BirthdayList::RolloverTest::rolloverCost_data()
+{
+    QTest::addColumn<int>("contactCount");
+    QTest::addColumn<int>("namedayDisplayMode");
+
+    QTest::newRow("1000 contacts, aggregated namedays") << 1000 << int(ModelConfiguration::NDM_AggregateEvents);
+    QTest::newRow("10000 contacts, aggregated namedays") << 10000 << int(ModelConfiguration::NDM_AggregateEvents);
+    QTest::newRow("10000 contacts, individual namedays") << 10000 << int(ModelConfiguration::NDM_IndividualEvents);
+    QTest::newRow("10000 contacts, all calendar names") << 10000 << int(ModelConfiguration::NDM_AllCalendarNames);
+}
+
+void BirthdayList::RolloverTest::rolloverCost()
+{
+    QFETCH(int, contactCount);
+    QFETCH(int, namedayDisplayMode);
+
+    ModelConfiguration conf = m_conf;
+    conf.namedayDisplayMode = ModelConfiguration::NamedayDisplayMode(namedayDisplayMode);
+
+    SimulatedClock clock(QDate(2013, 6, 15));
+    Model model;
+    model.setClock(&clock);
+    model.holdSources();
+    model.setConfiguration(conf);
+
+    Source_Synthetic::ContactSetParameters parameters;
+    parameters.contactCount = contactCount;
+    model.setContactSource(new Source_Synthetic(parameters));
+    model.performDayRollover();
+
+    // every repetition moves to the next day, as the applet does at midnight
+    QBENCHMARK {
+        clock.advanceDays(1);
+        model.performDayRollover();
+    }
+}
+
+
+QTEST_KDEMAIN(BirthdayList::RolloverTest, GUI)
+
+#include "birthdaylist_rollovertest.moc"
@@ -0,0 +1,156 @@
+/**
+ * @file    birthdaylist_soaktest.cpp
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_soaktest.h"
+#include "birthdaylist_model.h"
+#include <KAboutData>
+#include <KApplication>
+#include <KCmdLineArgs>
+#include <KDebug>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <unistd.h>
+
+
+BirthdayList::SoakTest::SoakTest(const ModelConfiguration &conf, const Source_Synthetic::ContactSetParameters &parameters,
+                                 const Source_Synthetic::ChurnSettings &churnSettings)
+: m_model(new Model()),
+m_source(new Source_Synthetic(parameters)),
+m_cycles(0)
+{
+    m_source->setChurnSettings(churnSettings);
+    m_model->holdSources();
+    m_model->setConfiguration(conf);
+    // the model takes the ownership of the source
+    m_model->setContactSource(m_source);
+    m_model->performDayRollover();
+}
+
+BirthdayList::SoakTest::~SoakTest()
+{
+    delete m_model;
+}
+
+void BirthdayList::SoakTest::run(int cycles)
+{
+    kDebug() << "Soak test: running" << cycles << "refresh cycles";
+    m_cycles = cycles;
+    m_latencies.clear();
+    m_residentMemory.clear();
+    m_residentMemory.append(residentMemory());
+
+    QElapsedTimer refreshTimer;
+    for (int cycle=1; cycle<=cycles; ++cycle) {
+        // the model refreshes synchronously when the source announces the change
+        refreshTimer.start();
+        m_source->performChurn();
+        m_latencies.append(refreshTimer.nsecsElapsed() / 1000);
+
+        if (cycle % m_memorySampleInterval == 0) {
+            // let the deferred deletions happen, as they would in the running plasmoid
+            QCoreApplication::sendPostedEvents(0, QEvent::DeferredDelete);
+            m_residentMemory.append(residentMemory());
+        }
+    }
+    qSort(m_latencies);
+
+    kDebug() << "Soak test finished:" << m_source->getAllContacts().size() << "contacts, refresh latency p50"
+             << latencyPercentile(50) << "us, p90" << latencyPercentile(90) << "us, p99" << latencyPercentile(99)
+             << "us, maximum" << latencyPercentile(100) << "us; resident memory" << m_residentMemory.first()
+             << "->" << m_residentMemory.last() << "bytes";
+}
+
+qint64 BirthdayList::SoakTest::latencyPercentile(int percentile) const
+{
+    if (m_latencies.isEmpty()) return 0;
+
+    int index = qBound(0, (m_latencies.size() * percentile + 99) / 100 - 1, m_latencies.size() - 1);
+    return m_latencies[index];
+}
+
+bool BirthdayList::SoakTest::writeResults(const QString &fileName) const
+{
+    QFile resultFile(fileName);
+    if (!resultFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        kWarning() << "Cannot write the soak test results to" << fileName;
+        return false;
+    }
+
+    // the memory growth is measured from the end of the first tenth of the run, when the caches are warm
+    qint64 warmMemory = m_residentMemory.value(m_residentMemory.size() / 10, m_residentMemory.first());
+
+    QTextStream stream(&resultFile);
+    stream << "{\n  \"benchmark\": \"birthdaylist-soak\",\n"
+           << "  \"cycles\": " << m_cycles << ",\n"
+           << "  \"contacts\": " << m_source->getAllContacts().size() << ",\n"
+           << "  \"latency_us\": { \"p50\": " << latencyPercentile(50) << ", \"p90\": " << latencyPercentile(90)
+           << ", \"p99\": " << latencyPercentile(99) << ", \"max\": " << latencyPercentile(100) << " },\n"
+           << "  \"resident_memory\": { \"initial\": " << m_residentMemory.first() << ", \"warm\": " << warmMemory
+           << ", \"final\": " << m_residentMemory.last() << ", \"growth\": " << m_residentMemory.last() - warmMemory << " },\n"
+           << "  \"resident_memory_samples\": [";
+    for (int i=0; i<m_residentMemory.size(); ++i) {
+        stream << (i > 0 ? ", " : "") << m_residentMemory[i];
+    }
+    stream << "]\n}\n";
+
+    kDebug() << "Soak test results written to" << fileName;
+    return true;
+}
+
+qint64 BirthdayList::SoakTest::residentMemory()
+{
+    // the second field of statm is the number of resident pages
+    QFile statmFile("/proc/self/statm");
+    if (!statmFile.open(QIODevice::ReadOnly)) return -1;
+
+    QList<QByteArray> fields = statmFile.readAll().split(' ');
+    if (fields.size() < 2) return -1;
+    return fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+}
+
+
+int main(int argc, char *argv[])
+{
+    KAboutData aboutData("birthdaylist-soaktest", 0, ki18n("BirthdayList soak test"), "1.0",
+                         ki18n("Refreshes the BirthdayList model with churning synthetic contacts and reports the latency and memory growth"));
+    KCmdLineArgs::init(argc, argv, &aboutData);
+
+    KCmdLineOptions options;
+    options.add("cycles <count>", ki18n("Number of the refresh cycles"), "10000");
+    options.add("contacts <count>", ki18n("Number of the synthetic contacts"), "1000");
+    options.add("+[file]", ki18n("File for the results in the JSON format"));
+    KCmdLineArgs::addCmdLineOptions(options);
+
+    KApplication app;
+    KCmdLineArgs *args = KCmdLineArgs::parsedArgs();
+
+    BirthdayList::ModelConfiguration conf;
+    conf.curNamedayFile = BIRTHDAYLIST_NAMEDAYDEFS_DIR "/namedays_sk.txt";
+
+    BirthdayList::Source_Synthetic::ContactSetParameters parameters;
+    parameters.contactCount = qMax(1, args->getOption("contacts").toInt());
+
+    BirthdayList::SoakTest soakTest(conf, parameters, BirthdayList::Source_Synthetic::ChurnSettings());
+    soakTest.run(qMax(1, args->getOption("cycles").toInt()));
+    bool written = args->count() == 0 || soakTest.writeResults(args->arg(0));
+
+    args->clear();
+    return written ? 0 : 1;
+}
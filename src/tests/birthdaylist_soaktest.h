@@ -0,0 +1,67 @@
+#ifndef BIRTHDAYLIST_SOAKTEST_H
+#define BIRTHDAYLIST_SOAKTEST_H
+
+/**
+ * @file    birthdaylist_soaktest.h
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_source_synthetic.h"
+#include <QList>
+
+
+namespace BirthdayList 
+{
+    class Model;
+    struct ModelConfiguration;
+
+    /**
+    * Runs the model with a churning synthetic contact source for many refresh cycles
+    * and reports the refresh latency percentiles and the growth of the resident memory,
+    * so that it can be checked that the plasmoid doesn't slow down or leak when it stays loaded for weeks.
+    */
+    class SoakTest
+    {
+    public:
+        SoakTest(const ModelConfiguration &conf, const Source_Synthetic::ContactSetParameters &parameters,
+                 const Source_Synthetic::ChurnSettings &churnSettings);
+        ~SoakTest();
+
+        /** Performs the given number of churn steps, each of them refreshing the model */
+        void run(int cycles);
+
+        /** Returns the given percentile (0-100) of the refresh durations in microseconds */
+        qint64 latencyPercentile(int percentile) const;
+        /** Writes the results to the given file in the JSON format */
+        bool writeResults(const QString &fileName) const;
+
+        /** Returns the resident memory of the process in bytes (or -1 if it cannot be determined) */
+        static qint64 residentMemory();
+
+    private:
+        Model *m_model;
+        Source_Synthetic *m_source;
+        int m_cycles;
+        /** Refresh durations in microseconds, sorted after the run */
+        QList<qint64> m_latencies;
+        /** Resident memory sampled every m_memorySampleInterval cycles */
+        QList<qint64> m_residentMemory;
+        static const int m_memorySampleInterval = 100;
+    };
+};
+
+
+#endif //BIRTHDAYLIST_SOAKTEST_H
@@ -0,0 +1,201 @@
+/**
+ * @file    birthdaylist_source_synthetic.cpp
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_source_synthetic.h"
+#include <KDebug>
+
+
+namespace {
+    /** Deterministic generator so that the same parameters always give the same contact set */
+    class RandomGenerator
+    {
+    public:
+        explicit RandomGenerator(uint seed) : m_state(seed) {
+        }
+
+        uint next() {
+            m_state = m_state * 1103515245u + 12345u;
+            return m_state >> 8;
+        }
+
+        double nextFraction() {
+            return double(next() & 0xffffff) / double(0x1000000);
+        }
+
+        QDate nextDate(int firstYear, int years) {
+            return QDate(firstYear, 1, 1).addDays(next() % (years * 365));
+        }
+
+    private:
+        uint m_state;
+    };
+}
+
+
+const char * const BirthdayList::Source_Synthetic::m_filterCustomFieldPrefix = "KADDRESSBOOK-BenchmarkGroup";
+const char * const BirthdayList::Source_Synthetic::m_filterValue = "yes";
+const char * const BirthdayList::Source_Synthetic::m_filterCategory = "Family";
+
+
+BirthdayList::Source_Synthetic::ContactSetParameters::ContactSetParameters()
+: contactCount(1000),
+birthdayDensity(0.8),
+anniversaryDensity(0.2),
+categoryDensity(0.3),
+namedayFieldDensity(0.1),
+customFieldCount(4),
+customFieldDensity(0.25),
+seed(1)
+{
+}
+
+
+BirthdayList::Source_Synthetic::ChurnSettings::ChurnSettings()
+: additions(1),
+edits(5),
+removals(1),
+burstInterval(50),
+burstFactor(100)
+{
+}
+
+
+BirthdayList::Source_Synthetic::Source_Synthetic(const ContactSetParameters &parameters, const QStringList &givenNames)
+: m_parameters(parameters),
+m_givenNames(givenNames),
+m_churnSteps(0),
+m_nextContactId(0),
+m_randomState(parameters.seed)
+{
+    kDebug() << "Generating" << parameters.contactCount << "synthetic contacts";
+    for (int i=0; i<parameters.contactCount; ++i) {
+        QString contactKey = QString("synthetic-%1").arg(m_nextContactId);
+        m_contacts.insert(contactKey, createContact(m_nextContactId++));
+        m_contactKeys.append(contactKey);
+    }
+
+    connect(&m_churnTimer, SIGNAL(timeout()), this, SLOT(performChurn()));
+}
+
+BirthdayList::Source_Synthetic::~Source_Synthetic()
+{
+}
+
+QHash<QString, BirthdayList::AddresseeInfo> BirthdayList::Source_Synthetic::createContacts(const ContactSetParameters &parameters, const QStringList &givenNames)
+{
+    static const char *categories[] = { "Friends", "Work", "Neighbours" };
+
+    RandomGenerator random(parameters.seed);
+    QHash<QString, AddresseeInfo> contacts;
+    contacts.reserve(parameters.contactCount);
+
+    for (int i=0; i<parameters.contactCount; ++i) {
+        AddresseeInfo contactInfo;
+        contactInfo.givenName = givenNames.isEmpty() ? QString("Given%1").arg(i % 500) : givenNames[random.next() % givenNames.size()];
+        contactInfo.name = QString("%1 Contact%2").arg(contactInfo.givenName).arg(i);
+        if (random.nextFraction() < 0.2) contactInfo.nickName = QString("Nick%1").arg(i);
+        contactInfo.email = QString("contact%1@example.org").arg(i);
+        if (random.nextFraction() < 0.3) contactInfo.homepage = QString("http://example.org/~contact%1").arg(i);
+
+        if (random.nextFraction() < parameters.birthdayDensity) contactInfo.birthday = random.nextDate(1930, 80);
+        if (random.nextFraction() < parameters.anniversaryDensity) {
+            contactInfo.customFields.insert("Custom_KADDRESSBOOK-X-Anniversary", random.nextDate(1960, 50));
+        }
+        if (random.nextFraction() < parameters.namedayFieldDensity) {
+            contactInfo.customFields.insert("Custom_KADDRESSBOOK-X-Nameday", random.nextDate(2000, 1));
+        }
+
+        if (random.nextFraction() < parameters.categoryDensity) contactInfo.categories.append(m_filterCategory);
+        contactInfo.categories.append(categories[random.next() % 3]);
+
+        for (int field=0; field<parameters.customFieldCount; ++field) {
+            bool isSet = random.nextFraction() < parameters.customFieldDensity;
+            contactInfo.customFields.insert(QString("Custom_%1%2").arg(m_filterCustomFieldPrefix).arg(field), isSet ? m_filterValue : "no");
+        }
+
+        contacts.insert(QString("benchmark-%1").arg(i), contactInfo);
+    }
+
+    return contacts;
+}
+
+const QHash<QString, BirthdayList::AddresseeInfo>& BirthdayList::Source_Synthetic::getAllContacts()
+{
+    return m_contacts;
+}
+
+void BirthdayList::Source_Synthetic::startChurn(int interval)
+{
+    m_churnTimer.start(interval);
+}
+
+void BirthdayList::Source_Synthetic::stopChurn()
+{
+    m_churnTimer.stop();
+}
+
+void BirthdayList::Source_Synthetic::performChurn()
+{
+    ++m_churnSteps;
+    int factor = 1;
+    if (m_churnSettings.burstInterval > 0 && m_churnSteps % m_churnSettings.burstInterval == 0) factor = m_churnSettings.burstFactor;
+
+    for (int i=0; i<m_churnSettings.additions * factor; ++i) {
+        QString contactKey = QString("synthetic-%1").arg(m_nextContactId);
+        m_contacts.insert(contactKey, createContact(m_nextContactId++));
+        m_contactKeys.append(contactKey);
+    }
+
+    for (int i=0; i<m_churnSettings.edits * factor && !m_contactKeys.isEmpty(); ++i) {
+        // an edited contact is replaced by a new random one under the same key
+        int index = randomContactIndex();
+        m_contacts.insert(m_contactKeys[index], createContact(m_contactKeys[index].section('-', 1).toInt()));
+    }
+
+    for (int i=0; i<m_churnSettings.removals * factor && !m_contactKeys.isEmpty(); ++i) {
+        int index = randomContactIndex();
+        m_contacts.remove(m_contactKeys[index]);
+        m_contactKeys.swap(index, m_contactKeys.size() - 1);
+        m_contactKeys.removeLast();
+    }
+
+    emit contactsUpdated();
+}
+
+BirthdayList::AddresseeInfo BirthdayList::Source_Synthetic::createContact(int contactId)
+{
+    ContactSetParameters parameters = m_parameters;
+    parameters.contactCount = 1;
+    parameters.seed = random();
+
+    AddresseeInfo contactInfo = createContacts(parameters, m_givenNames).begin().value();
+    contactInfo.name = QString("%1 Synthetic%2").arg(contactInfo.givenName).arg(contactId);
+    contactInfo.email = QString("synthetic%1@example.org").arg(contactId);
+    return contactInfo;
+}
+
+int BirthdayList::Source_Synthetic::randomContactIndex()
+{
+    return random() % m_contactKeys.size();
+}
+
+uint BirthdayList::Source_Synthetic::random()
+{
+    m_randomState = m_randomState * 1103515245u + 12345u;
+    return m_randomState >> 8;
+}
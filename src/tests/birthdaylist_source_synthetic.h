@@ -0,0 +1,120 @@
+#ifndef BIRTHDAYLIST_SOURCE_SYNTHETIC_H
+#define BIRTHDAYLIST_SOURCE_SYNTHETIC_H
+
+/**
+ * @file    birthdaylist_source_synthetic.h
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_source_contacts.h"
+#include <QStringList>
+#include <QTimer>
+
+
+namespace BirthdayList 
+{
+    /**
+    * Contact source generating synthetic contacts without Akonadi. Besides the initial contact set, 
+    * it changes the contacts at a configurable rate (additions, edits, removals and occasional bursts)
+    * and announces every change with contactsUpdated(), so that the model can be exercised for a long time.
+    */
+    class Source_Synthetic : public Source_Contacts
+    {
+        Q_OBJECT
+    public:
+        /** Describes a synthetic contact set; the densities are the fractions of the contacts having the given field */
+        struct ContactSetParameters
+        {
+            ContactSetParameters();
+
+            int contactCount;
+            double birthdayDensity;
+            double anniversaryDensity;
+            double categoryDensity;
+            /** Fraction of the contacts having the nameday in a custom date field (the rest is looked up by the given name) */
+            double namedayFieldDensity;
+            /** Number of the filter custom fields (m_filterCustomFieldPrefix followed by the field number) of each contact */
+            int customFieldCount;
+            double customFieldDensity;
+            uint seed;
+        };
+
+        /** Number of the contacts changed by one churn step */
+        struct ChurnSettings
+        {
+            ChurnSettings();
+
+            int additions;
+            int edits;
+            int removals;
+            /** Every burstInterval-th step is a burst (0 disables the bursts) */
+            int burstInterval;
+            /** The burst changes burstFactor times more contacts than a normal step */
+            int burstFactor;
+        };
+
+        /** The given names of the contacts are picked from the given list (e.g. from the nameday calendar) */
+        Source_Synthetic(const ContactSetParameters &parameters, const QStringList &givenNames = QStringList());
+        virtual ~Source_Synthetic();
+
+        /** Creates a synthetic contact set; the given names are picked from the given list */
+        static QHash<QString, AddresseeInfo> createContacts(const ContactSetParameters &parameters, const QStringList &givenNames);
+
+        /** Values of the filtered fields: the custom fields set to m_filterValue and the category m_filterCategory
+         *  are present in the fractions of the contacts given by the customFieldDensity and categoryDensity */
+        static const char * const m_filterCustomFieldPrefix;
+        static const char * const m_filterValue;
+        static const char * const m_filterCategory;
+
+        virtual const QHash<QString, AddresseeInfo>& getAllContacts();
+
+        void setChurnSettings(const ChurnSettings &settings) {
+            m_churnSettings = settings;
+        }
+        /** Starts changing the contacts every given number of milliseconds */
+        void startChurn(int interval);
+        void stopChurn();
+
+        /** Returns the number of performed churn steps */
+        int churnSteps() const {
+            return m_churnSteps;
+        }
+
+    public slots:
+        /** Performs one churn step immediately and emits contactsUpdated() */
+        void performChurn();
+
+    private:
+        AddresseeInfo createContact(int contactId);
+        int randomContactIndex();
+        uint random();
+
+    private:
+        ContactSetParameters m_parameters;
+        ChurnSettings m_churnSettings;
+        QHash<QString, AddresseeInfo> m_contacts;
+        /** Keys of the contacts, so that a random contact can be picked without iterating the hash */
+        QStringList m_contactKeys;
+        QStringList m_givenNames;
+        QTimer m_churnTimer;
+        int m_churnSteps;
+        int m_nextContactId;
+        uint m_randomState;
+    };
+};
+
+
+#endif //BIRTHDAYLIST_SOURCE_SYNTHETIC_H
@@ -0,0 +1,134 @@
+/**
+ * @file    birthdaylist_startupbenchmark.cpp
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_startupbenchmark.h"
+#include "birthdaylist_akonadistandin.h"
+#include "birthdaylist_diagnostics.h"
+#include <KAboutData>
+#include <KApplication>
+#include <KCmdLineArgs>
+#include <KDebug>
+#include <QFile>
+#include <QTextStream>
+
+
+BirthdayList::StartupBenchmark::StartupBenchmark(const ModelConfiguration &conf, int contactCount)
+: m_conf(conf),
+m_contactCount(contactCount),
+m_runs(0)
+{
+}
+
+void BirthdayList::StartupBenchmark::run(int runs)
+{
+    kDebug() << "Startup benchmark: performing" << runs << "startups with" << m_contactCount << "contacts";
+    m_runs = runs;
+    m_milestoneOrder.clear();
+    m_milestoneTimes.clear();
+
+    typedef QPair<QString, qint64> Milestone;
+    for (int i=0; i<runs; ++i) {
+        // the contacts are in the stand-in before the clock starts, as they would be in the Akonadi server
+        AkonadiStandIn *standIn = new AkonadiStandIn();
+        standIn->populate(m_contactCount);
+
+        Diagnostics *diagnostics = Diagnostics::instance();
+        diagnostics->restartMilestones();
+        standIn->createModel(m_conf);
+
+        foreach (const Milestone &milestone, diagnostics->milestones()) {
+            if (!m_milestoneOrder.contains(milestone.first)) m_milestoneOrder.append(milestone.first);
+            m_milestoneTimes[milestone.first].append(milestone.second);
+        }
+
+        delete standIn;
+    }
+
+    QMutableMapIterator<QString, QList<qint64> > timesIt(m_milestoneTimes);
+    while (timesIt.hasNext()) {
+        timesIt.next();
+        qSort(timesIt.value());
+    }
+
+    foreach (const QString &milestone, m_milestoneOrder) {
+        kDebug() << "Startup benchmark:" << milestone << "p50" << milestonePercentile(milestone, 50)
+                 << "us, p90" << milestonePercentile(milestone, 90) << "us";
+    }
+}
+
+qint64 BirthdayList::StartupBenchmark::milestonePercentile(const QString &milestone, int percentile) const
+{
+    const QList<qint64> times = m_milestoneTimes.value(milestone);
+    if (times.isEmpty()) return 0;
+
+    int index = qBound(0, (times.size() * percentile + 99) / 100 - 1, times.size() - 1);
+    return times[index];
+}
+
+bool BirthdayList::StartupBenchmark::writeResults(const QString &fileName) const
+{
+    QFile resultFile(fileName);
+    if (!resultFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        kWarning() << "Cannot write the startup benchmark results to" << fileName;
+        return false;
+    }
+
+    QTextStream stream(&resultFile);
+    stream << "{\n  \"benchmark\": \"birthdaylist-startup\",\n"
+           << "  \"runs\": " << m_runs << ",\n"
+           << "  \"contacts\": " << m_contactCount << ",\n"
+           << "  \"milestones\": [";
+    for (int i=0; i<m_milestoneOrder.size(); ++i) {
+        const QString &milestone = m_milestoneOrder[i];
+        stream << (i > 0 ? ",\n" : "\n")
+               << "    { \"milestone\": \"" << milestone << "\", \"runs\": " << m_milestoneTimes.value(milestone).size()
+               << ", \"p50_us\": " << milestonePercentile(milestone, 50) << ", \"p90_us\": " << milestonePercentile(milestone, 90)
+               << ", \"max_us\": " << milestonePercentile(milestone, 100) << " }";
+    }
+    stream << "\n  ]\n}\n";
+
+    kDebug() << "Startup benchmark results written to" << fileName;
+    return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+    KAboutData aboutData("birthdaylist-startupbenchmark", 0, ki18n("BirthdayList startup benchmark"), "1.0",
+                         ki18n("Measures the startup milestones of the BirthdayList model against the Akonadi stand-in"));
+    KCmdLineArgs::init(argc, argv, &aboutData);
+
+    KCmdLineOptions options;
+    options.add("contacts <count>", ki18n("Number of the contacts in the Akonadi stand-in"), "1000");
+    options.add("runs <count>", ki18n("Number of the measured startups"), "20");
+    options.add("+[file]", ki18n("File for the results in the JSON format"));
+    KCmdLineArgs::addCmdLineOptions(options);
+
+    KApplication app;
+    KCmdLineArgs *args = KCmdLineArgs::parsedArgs();
+
+    BirthdayList::ModelConfiguration conf;
+    conf.curNamedayFile = BIRTHDAYLIST_NAMEDAYDEFS_DIR "/namedays_sk.txt";
+
+    BirthdayList::StartupBenchmark startupBenchmark(conf, qMax(1, args->getOption("contacts").toInt()));
+    startupBenchmark.run(qMax(1, args->getOption("runs").toInt()));
+    bool written = args->count() == 0 || startupBenchmark.writeResults(args->arg(0));
+
+    args->clear();
+    return written ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+#ifndef BIRTHDAYLIST_STARTUPBENCHMARK_H
+#define BIRTHDAYLIST_STARTUPBENCHMARK_H
+
+/**
+ * @file    birthdaylist_startupbenchmark.h
+ * @author  Karol Slanina
+ *
+ * @section LICENSE
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+
+#include "birthdaylist_model.h"
+#include <QList>
+#include <QMap>
+#include <QStringList>
+
+
+namespace BirthdayList 
+{
+    /**
+    * Replays the startup of the applet headless: reads the nameday lists, creates the model and lets it read
+    * the contacts already present in the Akonadi stand-in. Every run records the same startup milestones
+    * as the applet does (see Diagnostics::recordMilestone). Built as the birthdaylist-startupbenchmark tool.
+    */
+    class StartupBenchmark
+    {
+    public:
+        StartupBenchmark(const ModelConfiguration &conf, int contactCount);
+
+        /** Performs the given number of startups */
+        void run(int runs);
+
+        /** Returns the given percentile (0-100) of the times of the given milestone in microseconds */
+        qint64 milestonePercentile(const QString &milestone, int percentile) const;
+        /** Writes the results to the given file in the JSON format */
+        bool writeResults(const QString &fileName) const;
+
+    private:
+        ModelConfiguration m_conf;
+        int m_contactCount;
+        /** Milestones in the order of their first occurrence */
+        QStringList m_milestoneOrder;
+        /** Times of the milestones in microseconds, sorted after the run */
+        QMap<QString, QList<qint64> > m_milestoneTimes;
+        int m_runs;
+    };
+};
+
+
+#endif //BIRTHDAYLIST_STARTUPBENCHMARK_H